@@ -1,6 +1,8 @@
 #include <assert.h>
 #include "CRT.hpp"
+#include "utils/Parallel.hpp"
 #include "NTL/ZZ.h"
+#include <algorithm>
 namespace MDL {
 static NTL::ZZ InvMod(NTL::ZZ a, NTL::ZZ p)
 {
@@ -16,36 +18,211 @@ static NTL::ZZ InvMod(NTL::ZZ a, NTL::ZZ p)
     return  x1;
 }
 
+static std::vector<NTL::ZZ> toZZ(const std::vector<long> &values)
+{
+    std::vector<NTL::ZZ> zz(values.size());
+    for (size_t i = 0; i < values.size(); i++)
+        zz[i] = NTL::to_ZZ(values[i]);
+    return zz;
+}
+
+/// Garner's loop for a one-off call, building a CRTBasis costs more than
+/// the conversion itself.
+static NTL::ZZ garner(const std::vector<long> &a,
+                      const std::vector<NTL::ZZ> &moduli)
+{
+    NTL::ZZ x(0), product(1), t;
+    for (size_t i = 0; i < moduli.size(); i++) {
+        const NTL::ZZ &m = moduli[i];
+        t = NTL::to_ZZ(i < a.size() ? a[i] : 0) - x;
+        t = (t % m) * MDL::InvMod(product % m, m) % m;
+        x += product * t;
+        product *= m;
+    }
+    return x;
+}
+
 template<>
 NTL::ZZ CRT(const std::vector<long> &a,
             const std::vector<long> &primes) {
-    NTL::ZZ product(1), sum(0);
-    auto size = a.size();
-
-    for (auto &prime : primes) product *= prime;
-
-    for (size_t i = 0; i < size; i++) {
-        auto p = product / primes[i];
-        sum += (a[i] * MDL::InvMod(p, NTL::to_ZZ(primes[i])) * p);
-    }
-    return sum % product;
+    return garner(a, toZZ(primes));
 }
 
 template<>
 NTL::ZZ CRT(const std::vector<long> &a,
             const std::vector<NTL::ZZ> &primes) {
-    NTL::ZZ product(1), sum(0);
-    auto size = a.size();
-    assert(size <= primes.size());
-    for (auto &prime : primes) {
-        product *= prime;
+    assert(a.size() <= primes.size());
+    return garner(a, primes);
+}
+
+CRTBasis::CRTBasis(const std::vector<long> &moduli)
+    : CRTBasis(toZZ(moduli)) {}
+
+CRTBasis::CRTBasis(const std::vector<NTL::ZZ> &moduli)
+    : m_moduli(moduli), m_product(1)
+{
+    m_inverses.resize(m_moduli.size());
+    for (size_t i = 0; i < m_moduli.size(); i++) {
+        assert(m_moduli[i] > 1);
+        m_inverses[i] = MDL::InvMod(m_product % m_moduli[i], m_moduli[i]);
+        m_product *= m_moduli[i];
+    }
+
+    m_tree.push_back(m_moduli);
+    while (m_tree.back().size() > 1) {
+        const auto &below = m_tree.back();
+        std::vector<NTL::ZZ> level((below.size() + 1) / 2);
+        for (size_t j = 0; j < level.size(); j++) {
+            level[j] = below[2 * j];
+            if (2 * j + 1 < below.size())
+                level[j] *= below[2 * j + 1];
+        }
+        m_tree.push_back(level);
+    }
+
+    m_word = std::all_of(m_moduli.begin(), m_moduli.end(),
+                         [](const NTL::ZZ &m) { return m < NTL_SP_BOUND; });
+    if (!m_word) return;
+    const size_t k = m_moduli.size();
+    m_wordModuli.resize(k);
+    m_wordInverses.resize(k);
+    m_wordInversesPrecon.resize(k);
+    m_radix.resize(k);
+    m_radixPrecon.resize(k);
+    for (size_t i = 0; i < k; i++) {
+        const long m = NTL::to_long(m_moduli[i]);
+        m_wordModuli[i] = m;
+        m_wordInverses[i] = NTL::to_long(m_inverses[i]);
+        m_wordInversesPrecon[i] = NTL::PrepMulModPrecon(m_wordInverses[i], m);
+        for (size_t j = 0; j < i; j++) {
+            m_radix[i].push_back(NTL::to_long(m_moduli[j] % m));
+            m_radixPrecon[i].push_back(NTL::PrepMulModPrecon(m_radix[i][j], m));
+        }
+    }
+}
+
+void CRTBasis::digits(std::vector<NTL::ZZ> &v,
+                      const std::vector<NTL::ZZ> &a) const
+{
+    const size_t k = m_moduli.size();
+    assert(a.size() <= k);
+    v.resize(k);
+    NTL::ZZ y;
+    for (size_t i = 0; i < k; i++) {
+        const auto &m = m_moduli[i];
+        // y = v[0] + v[1] m[0] + ... + v[i-1] m[0] ... m[i-2] mod m[i]
+        y = 0;
+        for (size_t j = i; j-- > 0; ) {
+            y *= m_moduli[j];
+            y += v[j];
+            y %= m;
+        }
+        if (i < a.size())
+            NTL::sub(y, a[i], y);
+        else
+            y = -y;
+        y %= m;
+        NTL::MulMod(v[i], y, m_inverses[i], m);
+    }
+}
+
+void CRTBasis::fromDigits(NTL::ZZ &x, const std::vector<NTL::ZZ> &v) const
+{
+    x = 0;
+    for (size_t i = v.size(); i-- > 0; ) {
+        x *= m_moduli[i];
+        x += v[i];
+    }
+}
+
+void CRTBasis::reconstruct(NTL::ZZ &x, const std::vector<NTL::ZZ> &a) const
+{
+    std::vector<NTL::ZZ> v;
+    digits(v, a);
+    fromDigits(x, v);
+}
+
+void CRTBasis::reconstruct(NTL::ZZ &x, const std::vector<long> &a) const
+{
+    reconstruct(x, toZZ(a));
+}
+
+void CRTBasis::wordDigits(std::vector<long> &v,
+                          const std::vector<const long *> &a,
+                          long slot) const
+{
+    const size_t k = m_wordModuli.size();
+    v.resize(k);
+    for (size_t i = 0; i < k; i++) {
+        const long m = m_wordModuli[i];
+        long y = 0;
+        for (size_t j = i; j-- > 0; ) {
+            y = NTL::MulModPrecon(y, m_radix[i][j], m, m_radixPrecon[i][j]);
+            y = NTL::AddMod(y, v[j] % m, m);
+        }
+        long ai = i < a.size() ? a[i][slot] % m : 0;
+        if (ai < 0) ai += m;
+        y = NTL::SubMod(ai, y, m);
+        v[i] = NTL::MulModPrecon(y, m_wordInverses[i], m, m_wordInversesPrecon[i]);
+    }
+}
+
+void CRTBasis::fromWordDigits(NTL::ZZ &x, const std::vector<long> &v) const
+{
+    x = 0;
+    for (size_t i = v.size(); i-- > 0; ) {
+        NTL::mul(x, x, m_wordModuli[i]);
+        NTL::add(x, x, v[i]);
+    }
+}
+
+void CRTBasis::reconstruct(std::vector<NTL::ZZ> &xs,
+                           const std::vector<const long *> &residues,
+                           long count) const
+{
+    assert(residues.size() <= m_moduli.size());
+    xs.resize(count);
+    // slots in blocks, each with its own buffers.
+    const long BLOCK = 256;
+    const long blocks = (count + BLOCK - 1) / BLOCK;
+    parallel::parallel_for(parallel::ALGEBRA, blocks, [&](long b) {
+        const long end = std::min(count, (b + 1) * BLOCK);
+        if (m_word) {
+            std::vector<long> v;
+            for (long s = b * BLOCK; s < end; s++) {
+                wordDigits(v, residues, s);
+                fromWordDigits(xs[s], v);
+            }
+            return;
+        }
+
+        std::vector<NTL::ZZ> a(residues.size()), v;
+        for (long s = b * BLOCK; s < end; s++) {
+            for (size_t i = 0; i < residues.size(); i++)
+                a[i] = residues[i][s];
+            digits(v, a);
+            fromDigits(xs[s], v);
+        }
+    });
+}
+
+void CRTBasis::reduce(std::vector<NTL::ZZ> &a, const NTL::ZZ &x) const
+{
+    if (m_moduli.empty()) {
+        a.clear();
+        return;
     }
 
-    for (size_t i = 0; i < size; i++) {
-        auto p = product / primes[i];
-        sum += (a[i] * MDL::InvMod(p, NTL::to_ZZ(primes[i])) * p);
+    std::vector<NTL::ZZ> above(1), below;
+    NTL::rem(above[0], x, m_product);
+    for (size_t l = m_tree.size() - 1; l-- > 0; ) {
+        const auto &level = m_tree[l];
+        below.resize(level.size());
+        for (size_t j = 0; j < level.size(); j++)
+            NTL::rem(below[j], above[j / 2], level[j]);
+        above.swap(below);
     }
-    return sum % product;
+    a.swap(above);
 }
 
 } // namespace MDL
@@ -13,5 +13,67 @@ NTL::ZZ CRT(const std::vector<T> &a, const std::vector<R> &p);
 
 template <>
 NTL::ZZ CRT(const std::vector<long> &a, const std::vector<NTL::ZZ> &p);
+
+/// @brief Pairwise coprime moduli with everything the CRT needs that does
+/// not depend on the remainders precomputed, for converting many values
+/// with the same moduli.
+class CRTBasis {
+public:
+    CRTBasis() {}
+
+    explicit CRTBasis(const std::vector<NTL::ZZ> &moduli);
+
+    explicit CRTBasis(const std::vector<long> &moduli);
+
+    size_t size() const { return m_moduli.size(); }
+
+    const std::vector<NTL::ZZ>& moduli() const { return m_moduli; }
+
+    const NTL::ZZ& product() const { return m_product; }
+
+    /// x in [0, product()) with x = a[i] mod moduli()[i], by Garner's
+    /// algorithm. Missing remainders are taken as 0, negative ones are
+    /// reduced first.
+    void reconstruct(NTL::ZZ &x, const std::vector<long> &a) const;
+
+    void reconstruct(NTL::ZZ &x, const std::vector<NTL::ZZ> &a) const;
+
+    /// xs[s] for s in [0, count) from the remainders residues[i][s] of
+    /// every modulus i, e.g. one decrypted slot vector per prime. With
+    /// single-precision moduli the digits are computed in word arithmetic.
+    /// The slots run in parallel on the ALGEBRA threads.
+    void reconstruct(std::vector<NTL::ZZ> &xs,
+                     const std::vector<const long *> &residues,
+                     long count) const;
+
+    /// a[i] = x mod moduli()[i] in [0, moduli()[i]), by a remainder tree.
+    void reduce(std::vector<NTL::ZZ> &a, const NTL::ZZ &x) const;
+private:
+    /// the mixed-radix digits v of x = v[0] + v[1] m[0] + v[2] m[0] m[1] ...
+    void digits(std::vector<NTL::ZZ> &v, const std::vector<NTL::ZZ> &a) const;
+
+    void fromDigits(NTL::ZZ &x, const std::vector<NTL::ZZ> &v) const;
+
+    /// digits() and fromDigits() for single-precision moduli.
+    void wordDigits(std::vector<long> &v, const std::vector<const long *> &a,
+                    long slot) const;
+
+    void fromWordDigits(NTL::ZZ &x, const std::vector<long> &v) const;
+
+    std::vector<NTL::ZZ> m_moduli;
+    // (m[0] ... m[i-1])^-1 mod m[i]
+    std::vector<NTL::ZZ> m_inverses;
+    NTL::ZZ m_product;
+    // tree[0] = moduli, tree[l + 1][j] = tree[l][2j] * tree[l][2j + 1].
+    std::vector<std::vector<NTL::ZZ>> m_tree;
+    // set when every modulus is below NTL_SP_BOUND.
+    bool m_word = false;
+    std::vector<long> m_wordModuli;
+    std::vector<long> m_wordInverses;
+    std::vector<NTL::mulmod_precon_t> m_wordInversesPrecon;
+    // m[j] mod m[i] for j < i.
+    std::vector<std::vector<long>> m_radix;
+    std::vector<std::vector<NTL::mulmod_precon_t>> m_radixPrecon;
+};
 } // namespace MDL
-#endif // algebra//crt.hpp
+#endif // algebra/CRT.hpp
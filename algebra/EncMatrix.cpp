@@ -1,32 +1,102 @@
 #include "utils/MatrixAlgebraUtils.hpp"
 #include "utils/FHEUtils.hpp"
 #include "fhe/replicate.h"
+#include "utils/Parallel.hpp"
 #include "EncMatrix.hpp"
-#include <thread>
+#include "MatrixProduct.hpp"
+#include <map>
 #include <vector>
 namespace MDL {
-#ifdef FHE_THREADS
-const long WORKER_NR = 8;
-#else
-const long WORKER_NR = 1;
-#endif
 EncMatrix& EncMatrix::pack(const Matrix<long>  & mat,
-                           const EncryptedArray& ea)
+                           const EncryptedArray& ea,
+                           MatrixPacking         packing)
 {
-    this->resize(mat.rows(), _pk);
+    _packing = packing;
+    _rows = mat.rows();
+    _cols = mat.cols();
+    _offsets.clear();
+    if (packing == FLAT_PACKING &&
+        (_rows != _cols || _rows * _rows > ea.size())) {
+        fprintf(stderr, "Warnning! FLAT_PACKING needs a square matrix "
+                "of at most %ld entries, packing row-wisely\n", ea.size());
+        _packing = packing = ROW_PACKING;
+    }
+
+    if (packing == FLAT_PACKING) {
+        this->resize(1, _pk);
+        this->at(0).pack(flatten(mat), ea);
+        return *this;
+    }
+
+    if (packing == ROW_PACKING) {
+        this->resize(mat.rows(), _pk);
 
-    for (size_t r = 0; r < mat.rows(); r++) {
-        this->at(r).pack(mat[r], ea);
+        for (size_t r = 0; r < mat.rows(); r++) {
+            this->at(r).pack(mat[r], ea);
+        }
+        return *this;
+    }
+
+    // keep the all-zero diagonals too, the layout should not depend
+    // on the values.
+    auto diags = diagonals(mat, ea.size(), false);
+    this->resize(diags.size(), _pk);
+    for (auto &kv : diags) {
+        this->at(_offsets.size()).pack(kv.second, ea);
+        _offsets.push_back(kv.first);
     }
     return *this;
 }
 
+/// decrypt the diagonals and put them back to a matrix.
+template<typename U>
+static void unpackDiagonals(Matrix<U>             & result,
+                            const EncMatrix       & mat,
+                            long                    rows,
+                            long                    cols,
+                            const FHESecKey       & sk,
+                            const EncryptedArray  & ea,
+                            bool                    negate)
+{
+    std::map<long, Vector<U>> diags;
+    for (size_t i = 0; i < mat.size(); i++)
+        mat[i].unpack(diags[mat.offsets()[i]], sk, ea, negate);
+    result = fromDiagonals(diags, rows, cols);
+}
+
+/// decrypt a FLAT_PACKING matrix.
+template<typename U>
+static void unpackFlat(Matrix<U>             & result,
+                       const EncMatrix       & mat,
+                       long                    rows,
+                       long                    cols,
+                       const FHESecKey       & sk,
+                       const EncryptedArray  & ea,
+                       bool                    negate)
+{
+    Vector<U> flat;
+    mat[0].unpack(flat, sk, ea, negate);
+    result.resize(rows);
+    for (long r = 0; r < rows; r++)
+        result[r].assign(flat.begin() + r * cols, flat.begin() + (r + 1) * cols);
+}
+
 template<>
 void EncMatrix::unpack(Matrix<long>        & result,
                        const FHESecKey     & sk,
                        const EncryptedArray& ea,
                        bool                  negate) const
 {
+    if (_packing == DIAGONAL_PACKING) {
+        unpackDiagonals(result, *this, _rows, _cols, sk, ea, negate);
+        return;
+    }
+
+    if (_packing == FLAT_PACKING) {
+        unpackFlat(result, *this, _rows, _cols, sk, ea, negate);
+        return;
+    }
+
     result.resize(this->size());
 
     for (size_t r = 0; r < this->size(); r++) {
@@ -40,44 +110,52 @@ void EncMatrix::unpack(Matrix<NTL::ZZX>    & result,
                        const EncryptedArray& ea,
                        bool                  negate) const
 {
-    result.resize(this->size());
-    std::vector<std::thread> workers;
-    std::atomic<size_t> counter(0UL);
-    for (long wr = 0; wr < WORKER_NR && wr < this->size(); wr++) {
-        workers.push_back(std::move(std::thread([this, &result, &counter, &sk, &ea, &negate](){
-                                                size_t r;
-                                                while ((r = counter.fetch_add(1)) < this->size()) {
-                                                this->at(r).unpack(result[r], sk, ea, negate);
-                                                }
-                                                })));
+    if (_packing == DIAGONAL_PACKING) {
+        unpackDiagonals(result, *this, _rows, _cols, sk, ea, negate);
+        return;
     }
 
-    for (auto &&wr : workers) wr.join();
+    if (_packing == FLAT_PACKING) {
+        unpackFlat(result, *this, _rows, _cols, sk, ea, negate);
+        return;
+    }
+
+    result.resize(this->size());
+    parallel::parallel_for(parallel::ALGEBRA, this->size(),
+                           [this, &result, &sk, &ea, &negate](long r) {
+        this->at(r).unpack(result[r], sk, ea, negate);
+    });
 }
 
 EncVector EncMatrix::dot(const EncVector     & oth,
                          const EncryptedArray& ea) const
 {
-    std::vector<EncVector> result(this->size(),
-                                  oth.getPubKey());
-    std::vector<std::thread> workers;
-    std::atomic<size_t> counter(0UL);
-    for (int wr = 0; wr < WORKER_NR; wr++) {
-        workers.push_back(std::move(std::thread([this, &result,
-                                                 &counter, &oth, &ea]()
-            {
-                size_t next;
+    if (_packing == DIAGONAL_PACKING) {
+        std::vector<const Ctxt *> diags;
+        for (auto &diag : *this) diags.push_back(&diag);
+        EncVector result(oth);
+        diagonalTransform(result, diags, _offsets, ea,
+                          parallel::threads(parallel::ALGEBRA));
+        return result;
+    }
 
-                while ((next = counter.fetch_add(1)) < ea.size()) {
-                    result[next] = this->at(next);
-                    result[next].dot(oth, ea);
-                    auto one_bit_mask = make_bit_mask(ea, next);
-                    result[next].multByConstant(one_bit_mask);
-                }
-            })));
+    if (_packing == FLAT_PACKING) {
+        EncVector result(oth);
+        matrixVectorProduct(result, this->at(0), _rows, ea,
+                            parallel::threads(parallel::ALGEBRA));
+        return result;
     }
 
-    for (auto && wr : workers) wr.join();
+    std::vector<EncVector> result(this->size(),
+                                  oth.getPubKey());
+    parallel::parallel_for(parallel::ALGEBRA, ea.size(),
+                           [this, &result, &oth, &ea](long next) {
+        result[next] = this->at(next);
+        // the rows already run in parallel.
+        result[next].dot(oth, ea, 1);
+        auto one_bit_mask = make_bit_mask(ea, next);
+        result[next].multByConstant(one_bit_mask);
+    });
 
     for (size_t r = 1; r < result.size(); r++) {
         result[0] += result[r];
@@ -89,31 +167,32 @@ EncVector EncMatrix::column_dot(const EncVector     & oth,
                                 const EncryptedArray& ea,
                                 long                  col_to_process) const
 {
+    if (_packing != ROW_PACKING) {
+        fprintf(stderr, "Warnning! column_dot needs a row-packed matrix!\n");
+        return EncVector(_pk);
+    }
+
     std::vector<EncVector>   parts(this->size(), this->at(0).getPubKey());
-    std::atomic<size_t>      counter(0UL);
-    std::vector<std::thread> workers;
     col_to_process = col_to_process == 0 ? ea.size() : col_to_process;
 
-    for (int wr = 0; wr < WORKER_NR; wr++) {
-        workers.push_back(std::move(std::thread([&oth, &ea, &parts,
-                                                 &counter, &col_to_process,
-                                                 this]() {
-                size_t c;
-
-                while ((c = counter.fetch_add(1)) < col_to_process) {
-                    EncVector vec(oth);
-                    replicate(ea, vec, c);
-                    vec.multiplyBy(this->at(c));
-                    parts[c] = vec;
-                }
-            })));
-    }
-
-    for (auto && wr : workers) wr.join();
+    // the replicas come one by one, each block of them is multiplied in
+    // parallel.
+    replicateBlocks(ea, oth, col_to_process,
+                    parallel::threads(parallel::ALGEBRA),
+                    [&parts, this](long first, std::vector<Ctxt> &replicas) {
+        parallel::parallel_for(parallel::ALGEBRA, replicas.size(),
+                               [&parts, &replicas, first, this](long i) {
+            Ctxt &part = parts[first + i];
+            part = replicas[i];
+            part *= this->at(first + i);
+        });
+    });
 
     EncVector result(parts[0]);
 
     for (size_t i = 1; i < this->size(); i++) result += parts[i];
+    // the products were summed unrelinearized.
+    result.reLinearize();
 
     return result;
 }
@@ -121,7 +200,7 @@ EncVector EncMatrix::column_dot(const EncVector     & oth,
 EncMatrix& EncMatrix::transpose(const EncryptedArray& ea)
 {
     // need to be square matrix
-    if (ea.size() != this->size()) return *this;
+    if (ea.size() != this->size() || _packing != ROW_PACKING) return *this;
 
     auto dim = ea.size();
     auto mat = *this;
@@ -156,30 +235,37 @@ EncMatrix& EncMatrix::dot(const EncMatrix &oth,
        [1 1] * [5 6] + [2 2] * [7 8] = [19 22]
        [3 3] * [5 6] + [4 4] * [7 8] = [43 50]
      */
+    if (_packing == FLAT_PACKING && oth.packing() == FLAT_PACKING &&
+        _rows == oth._rows) {
+        matrixProduct(this->at(0), oth[0], _rows, ea,
+                      parallel::threads(parallel::ALGEBRA));
+        return *this;
+    }
+
+    if (_packing != ROW_PACKING || oth.packing() != ROW_PACKING) {
+        fprintf(stderr, "Warnning! dot needs row-packed matrices!\n");
+        return *this;
+    }
+
     auto rows_nr = this->size();
     col_to_process = col_to_process == 0 ? ea.size() : col_to_process;
     assert(rows_nr == oth.size());
     assert(col_to_process <= ea.size());
-    std::vector<std::thread> workers;
-    std::atomic<long> counter(0L);
-    for (long wr = 0; wr < WORKER_NR; wr++) {
-        workers.push_back(std::move(std::thread([this, &ea, &col_to_process,
-                                                &rows_nr, &oth, &counter]() {
-            long row;
-            while ((row = counter.fetch_add(1)) < rows_nr) {
-                EncVector oneRow(_pk);
-                for (size_t col = 0; col < col_to_process; col++) {
-                    auto tmp(this->at(row));
-                    replicate(ea, tmp, col);
-                    tmp.multiplyBy(oth[col]);
-                    if (col > 0) oneRow += tmp;
-                    else oneRow = tmp;
-                }
-                this->at(row) = oneRow;
-            } })));
-    }
-
-    for (auto &&wr : workers) wr.join();
+    parallel::parallel_for(parallel::ALGEBRA, rows_nr,
+                           [this, &ea, &col_to_process, &oth](long row) {
+        EncVector oneRow(_pk);
+        replicateAll(ea, this->at(row), col_to_process,
+                     [&oneRow, &oth](long col, const Ctxt &replica) {
+            // sum the products unrelinearized, relinearize once.
+            Ctxt tmp(replica);
+            tmp *= oth[col];
+            Ctxt &sum = oneRow;
+            if (col > 0) sum += tmp;
+            else sum = tmp;
+        });
+        oneRow.reLinearize();
+        this->at(row) = oneRow;
+    });
     return *this;
 }
 
@@ -6,6 +6,7 @@
 #include <vector>
 #include "EncVector.hpp"
 #include "Matrix.hpp"
+#include "LinearTransform.hpp"
 namespace MDL {
 class EncMatrix : public std::vector<EncVector> {
 public:
@@ -14,15 +15,27 @@ public:
            _pk(pk)
         {}
 
+    /// @param packing. With DIAGONAL_PACKING the i-th ciphertext holds
+    ///                 the generalized diagonal of offset offsets()[i],
+    ///                 see diagonals() in LinearTransform.hpp.
     EncMatrix& pack(const Matrix<long>  & mat,
-                    const EncryptedArray& ea);
+                    const EncryptedArray& ea,
+                    MatrixPacking         packing = ROW_PACKING);
+
+    MatrixPacking packing() const { return _packing; }
+
+    /// The offsets of the diagonals of a DIAGONAL_PACKING matrix.
+    const std::vector<long>& offsets() const { return _offsets; }
 
     EncMatrix& transpose(const EncryptedArray& ea);
 
+    /// Matrix-vector product. A DIAGONAL_PACKING matrix uses one rotation
+    /// and one multiplication per diagonal, see diagonalTransform().
     EncVector dot(const EncVector     & oth,
                   const EncryptedArray& ea) const;
     /// To compute the product of two encrypted matrices.
-    /// Both matrices are assumed to be encrypted row-wisely.
+    /// Both matrices are assumed to be encrypted row-wisely, or both
+    /// in FLAT_PACKING, see matrixProduct().
     /// @param oth. A row-wise encrypted matrix
     /// @param ea. An EncryptedArray instance, to obtain the number of slots
     /// @param col_to_process. We assume that the plaintext matrix may has
@@ -60,11 +73,10 @@ public:
     EncMatrix& multByConstant(const NTL::ZZX &cons);
 private:
     const FHEPubKey& _pk;
-    #ifdef FHE_THREADS
-    static const int WORKER_NR = 8;
-    #else // ifdef FHE_THREADS
-    static const int WORKER_NR = 1;
-    #endif // ifdef FHE_THREADS
+    MatrixPacking _packing = ROW_PACKING;
+    std::vector<long> _offsets;
+    long _rows = 0;
+    long _cols = 0;
 };
 }
 #endif // ENCMATRIX_HPP
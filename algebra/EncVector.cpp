@@ -1,16 +1,11 @@
 #include "EncVector.hpp"
 #include "EncMatrix.hpp"
 #include "fhe/replicate.h"
+#include "utils/Parallel.hpp"
+#include "utils/FHEUtils.hpp"
 #include <NTL/ZZX.h>
 #include <vector>
-#include <atomic>
-#include <thread>
 namespace MDL {
-#ifdef FHE_THREAD
-const long WORKER_NR = 8;
-#else
-const long WORKER_NR = 1;
-#endif
 EncVector& EncVector::pack(const Vector<long>  & vec,
                            const EncryptedArray& ea)
 {
@@ -73,10 +68,12 @@ bool EncVector::unpack(Vector<NTL::ZZX>    & result,
 }
 
 EncVector& EncVector::dot(const EncVector     & oth,
-                          const EncryptedArray& ea)
+                          const EncryptedArray& ea,
+                          long                  parallelism)
 {
+    if (parallelism <= 0) parallelism = parallel::threads(parallel::ALGEBRA);
     this->multiplyBy(oth);
-    totalSums(ea, *this);
+    rotateSums(ea, *this, ea.size(), 1, parallelism);
     return *this;
 }
 
@@ -85,21 +82,16 @@ EncMatrix EncVector::covariance(const EncryptedArray& ea, long actualDimension)
     actualDimension = actualDimension == 0 ? ea.size() : actualDimension;
     EncMatrix mat(getPubKey());
     mat.resize(actualDimension, *this);
-    std::atomic<long> counter(0);
-    std::vector<std::thread> workers;
-    for (long wr = 0; wr < WORKER_NR; wr++) {
-        workers.push_back(std::move(std::thread([&counter, &actualDimension,
-                                                &mat, &ea, this]() {
-            long next;
-            while((next = counter.fetch_add(1)) < actualDimension) {
-                auto tmp(*this);
-                replicate(ea, tmp, next);
-                mat[next].multiplyBy(tmp);
-            }
-            })));
-    }
-
-    for (auto &&wr : workers) wr.join();
+    // the replicas come one by one, each block of them is multiplied in
+    // parallel.
+    replicateBlocks(ea, *this, actualDimension,
+                    parallel::threads(parallel::ALGEBRA),
+                    [&mat](long first, std::vector<Ctxt> &replicas) {
+        parallel::parallel_for(parallel::ALGEBRA, replicas.size(),
+                               [&mat, &replicas, first](long i) {
+            mat[first + i].multiplyBy(replicas[i]);
+        });
+    });
     return mat;
 }
 } // namespace MDL
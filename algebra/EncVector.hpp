@@ -20,8 +20,11 @@ public:
                                                 const FHEPubKey     & pk,
                                                 const EncryptedArray& ea);
 
+    /// @param parallelism: the threads the slot summation may use,
+    ///                     0 for parallel::threads(parallel::ALGEBRA).
     EncVector& dot(const EncVector     & oth,
-                   const EncryptedArray& ea);
+                   const EncryptedArray& ea,
+                   long                  parallelism = 0);
 
     template<typename U>
     bool unpack(Vector<U>           & result,
@@ -0,0 +1,143 @@
+#include "LinearTransform.hpp"
+#include "utils/ThreadPool.hpp"
+#include "fhe/EncryptedArray.h"
+#include "fhe/Ctxt.h"
+#include <NTL/ZZX.h>
+#include <cassert>
+#include <cmath>
+namespace MDL {
+std::map<long, Vector<long>> diagonals(const Matrix<long> &mat,
+                                       long slots,
+                                       bool skipZero)
+{
+    std::map<long, Vector<long>> diags;
+    const long rows = mat.rows();
+    const long cols = mat.cols();
+    for (long o = 1 - rows; o < cols; o++) {
+        Vector<long> diag(slots, 0);
+        bool zero = true;
+        for (long j = std::max(0L, -o); j < rows && j + o < cols; j++) {
+            diag[j] = mat[j][j + o];
+            if (diag[j] != 0) zero = false;
+        }
+        if (!zero || !skipZero) diags.insert(std::make_pair(o, diag));
+    }
+    return diags;
+}
+
+/// out[(j + s) mod n] = vec[j]
+static Vector<long> rotateRight(const Vector<long> &vec, long s)
+{
+    const long n = vec.size();
+    Vector<long> out(n);
+    for (long j = 0; j < n; j++)
+        out[(j + s) % n] = vec[j];
+    return out;
+}
+
+void linearTransform(Ctxt &ctxt,
+                     const Matrix<long> &mat,
+                     const EncryptedArray &ea,
+                     long parallelism)
+{
+    const long n = ea.size();
+    assert(static_cast<long>(mat.rows()) <= n);
+    assert(static_cast<long>(mat.cols()) <= n);
+    linearTransform(ctxt, diagonals(mat, n), ea, parallelism);
+}
+
+static bool allOnes(const Vector<long> &mask)
+{
+    for (auto e : mask)
+        if (e != 1) return false;
+    return true;
+}
+
+void linearTransform(Ctxt &ctxt,
+                     const std::map<long, Vector<long>> &diags,
+                     const EncryptedArray &ea,
+                     long parallelism)
+{
+    const long n = ea.size();
+    // offsets taken modulo the slots; the supports of o and o - n are
+    // disjoint, so their masks can be merged.
+    std::map<long, Vector<long>> masks;
+    for (auto &kv : diags) {
+        long o = ((kv.first % n) + n) % n;
+        auto it = masks.find(o);
+        if (it == masks.end()) masks.insert(std::make_pair(o, kv.second));
+        else it->second += kv.second;
+    }
+
+    if (masks.empty()) {
+        ctxt.multByConstant(NTL::ZZX());
+        return;
+    }
+
+    // o = giant * g + baby, the babies rotate ctxt and the masks of a
+    // giant step are pre-rotated right by giant * g.
+    const long g = static_cast<long>(std::ceil(std::sqrt(masks.rbegin()->first + 1.0)));
+    std::map<long, long> babyIndex;
+    std::map<long, std::vector<long>> giants;
+    for (auto &kv : masks) {
+        babyIndex.insert(std::make_pair(kv.first % g, 0L));
+        giants[kv.first / g].push_back(kv.first);
+    }
+
+    std::vector<long> babySteps;
+    for (auto &kv : babyIndex) {
+        kv.second = babySteps.size();
+        babySteps.push_back(kv.first);
+    }
+
+    auto &pool = ThreadPool::global();
+    std::vector<Ctxt> babies(babySteps.size(), ctxt);
+    pool.parallel_for(babySteps.size(), [&](long k) {
+        if (babySteps[k] != 0) ea.rotate(babies[k], -babySteps[k]);
+    }, parallelism);
+
+    std::vector<long> giantSteps;
+    for (auto &kv : giants) giantSteps.push_back(kv.first);
+    std::vector<Ctxt> parts(giantSteps.size(), ctxt);
+    pool.parallel_for(giantSteps.size(), [&](long k) {
+        const long shift = giantSteps[k] * g;
+        Ctxt &part = parts[k];
+        bool first = true;
+        for (long o : giants.at(giantSteps[k])) {
+            Ctxt tmp(babies[babyIndex.at(o % g)]);
+            if (!allOnes(masks.at(o)))
+                tmp.multByConstant(rotateRight(masks.at(o), shift).encode(ea));
+            if (first) part = tmp;
+            else part += tmp;
+            first = false;
+        }
+        if (shift != 0) ea.rotate(part, -shift);
+    }, parallelism);
+
+    ctxt = parts[0];
+    for (size_t k = 1; k < parts.size(); k++) ctxt += parts[k];
+}
+
+void diagonalTransform(Ctxt &ctxt,
+                       const std::vector<const Ctxt *> &diags,
+                       const std::vector<long> &offsets,
+                       const EncryptedArray &ea,
+                       long parallelism)
+{
+    assert(diags.size() == offsets.size());
+    if (diags.empty()) {
+        ctxt.multByConstant(NTL::ZZX());
+        return;
+    }
+
+    std::vector<Ctxt> terms(diags.size(), ctxt);
+    ThreadPool::global().parallel_for(diags.size(), [&](long k) {
+        if (offsets[k] % ea.size() != 0) ea.rotate(terms[k], -offsets[k]);
+        terms[k] *= *diags[k];
+    }, parallelism);
+
+    ctxt = terms[0];
+    for (size_t k = 1; k < terms.size(); k++) ctxt += terms[k];
+    ctxt.reLinearize();
+}
+} // namespace MDL
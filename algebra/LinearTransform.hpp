@@ -0,0 +1,77 @@
+#ifndef ALGEBRA_LINEARTRANSFORM_HPP
+#define ALGEBRA_LINEARTRANSFORM_HPP
+#include "Matrix.hpp"
+#include "Vector.hpp"
+#include <map>
+#include <vector>
+class Ctxt;
+class EncryptedArray;
+namespace MDL {
+/// How the rows of a matrix are laid in ciphertexts.
+/// ROW_PACKING: one ciphertext per row.
+/// DIAGONAL_PACKING: one ciphertext per generalized diagonal, see diagonals().
+/// FLAT_PACKING: a d x d matrix in one ciphertext in row-major order,
+///               needs d * d slots, see MatrixProduct.hpp.
+enum MatrixPacking {
+    ROW_PACKING = 0,
+    DIAGONAL_PACKING,
+    FLAT_PACKING
+};
+
+/// The generalized diagonals of mat, diag_o[j] = mat[j][j + o] for
+/// -rows < o < cols, so that (mat * v)[j] = sum_o diag_o[j] * v[j + o].
+/// No index wraps around, so the offsets hold for any number of slots
+/// not less than the rows and the columns of mat.
+/// @param slots. The length of the diagonals.
+/// @param skipZero. Drop the diagonals that are all zero.
+std::map<long, Vector<long>> diagonals(const Matrix<long> &mat,
+                                       long slots,
+                                       bool skipZero = true);
+
+/// Restore a rows x cols matrix from its generalized diagonals.
+template<typename T>
+Matrix<T> fromDiagonals(const std::map<long, Vector<T>> &diags,
+                        long rows,
+                        long cols)
+{
+    Matrix<T> mat(rows, cols);
+    for (auto &kv : diags) {
+        for (long j = 0; j < rows; j++) {
+            long c = j + kv.first;
+            if (c >= 0 && c < cols && j < static_cast<long>(kv.second.size()))
+                mat[j][c] = kv.second[j];
+        }
+    }
+    return mat;
+}
+
+/// ctxt = mat * ctxt for a plaintext matrix (Halevi-Shoup).
+/// The diagonals are evaluated in a baby-step/giant-step layout with the
+/// plaintext masks pre-rotated, which costs about 2 * sqrt(#offsets)
+/// rotations and only plaintext multiplications, i.e. no ciphertext level.
+/// @param parallelism. The threads the rotations may use.
+void linearTransform(Ctxt &ctxt,
+                     const Matrix<long> &mat,
+                     const EncryptedArray &ea,
+                     long parallelism = 1);
+
+/// ctxt = sum_o diags[o] * (ctxt rotated left by o), for any linear map
+/// of the slots given by its generalized diagonals (length ea.size()).
+/// Diagonals of all ones skip the plaintext multiplication.
+void linearTransform(Ctxt &ctxt,
+                     const std::map<long, Vector<long>> &diags,
+                     const EncryptedArray &ea,
+                     long parallelism = 1);
+
+/// ctxt = sum_k diags[k] * (ctxt rotated left by offsets[k]), i.e. the
+/// product of a diagonal-packed encrypted matrix with ctxt. Needs one
+/// rotation and one multiplication per diagonal, a single level and a
+/// single relinearization.
+/// @param parallelism. The threads the rotations may use.
+void diagonalTransform(Ctxt &ctxt,
+                       const std::vector<const Ctxt *> &diags,
+                       const std::vector<long> &offsets,
+                       const EncryptedArray &ea,
+                       long parallelism = 1);
+} // namespace MDL
+#endif // algebra/LinearTransform.hpp
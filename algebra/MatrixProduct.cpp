@@ -0,0 +1,111 @@
+#include "MatrixProduct.hpp"
+#include "LinearTransform.hpp"
+#include "utils/FHEUtils.hpp"
+#include "utils/ThreadPool.hpp"
+#include "fhe/EncryptedArray.h"
+#include "fhe/Ctxt.h"
+#include <cassert>
+#include <functional>
+#include <map>
+namespace MDL {
+/// the diagonals of the permutation that moves the slot source(l) to the
+/// slot l, for l < size. The other slots become zero.
+static std::map<long, Vector<long>> permutation(long slots,
+                                                long size,
+                                                const std::function<long(long)> &source)
+{
+    std::map<long, Vector<long>> diags;
+    for (long l = 0; l < size; l++) {
+        long o = source(l) - l;
+        auto it = diags.find(o);
+        if (it == diags.end())
+            it = diags.insert(std::make_pair(o, Vector<long>(slots, 0))).first;
+        it->second[l] = 1;
+    }
+    return diags;
+}
+
+void matrixProduct(Ctxt &A,
+                   const Ctxt &B,
+                   long d,
+                   const EncryptedArray &ea,
+                   long parallelism)
+{
+    const long n = ea.size();
+    const long dd = d * d;
+    assert(dd <= n);
+
+    Ctxt sigmaA(A), tauB(B);
+    {
+        auto sigma = permutation(n, dd, [d](long l) {
+            long i = l / d, j = l % d;
+            return d * i + (i + j) % d;
+        });
+        auto tau = permutation(n, dd, [d](long l) {
+            long i = l / d, j = l % d;
+            return d * ((i + j) % d) + j;
+        });
+        TaskGroup group;
+        group.run([&]() { linearTransform(sigmaA, sigma, ea, parallelism); });
+        linearTransform(tauB, tau, ea, parallelism);
+        group.wait();
+    }
+
+    // with room for two copies, psi^k is a plain rotation of tau(B)
+    // duplicated behind itself.
+    const bool duplicated = 2 * dd <= n;
+    if (duplicated) {
+        Ctxt copy(tauB);
+        ea.rotate(copy, dd);
+        tauB += copy;
+    }
+
+    std::vector<Ctxt> terms(d, A);
+    ThreadPool::global().parallel_for(d, [&](long k) {
+        Ctxt a(sigmaA), b(tauB);
+        if (k > 0) {
+            auto phi = permutation(n, dd, [d, k](long l) {
+                return d * (l / d) + (l % d + k) % d;
+            });
+            linearTransform(a, phi, ea);
+            if (duplicated) {
+                ea.rotate(b, -d * k);
+            } else {
+                auto psi = permutation(n, dd, [d, k, dd](long l) {
+                    return (l + d * k) % dd;
+                });
+                linearTransform(b, psi, ea);
+            }
+        }
+        a *= b;
+        terms[k] = a;
+    }, parallelism);
+
+    A = terms[0];
+    for (long k = 1; k < d; k++) A += terms[k];
+    A.reLinearize();
+}
+
+void matrixVectorProduct(Ctxt &v,
+                         const Ctxt &A,
+                         long d,
+                         const EncryptedArray &ea,
+                         long parallelism)
+{
+    const long n = ea.size();
+    assert(d * d <= n);
+    // v[j] to every slot d * i + j: the slots from d * d on stay zero.
+    rotateSums(ea, v, d, -d, parallelism);
+    v.multiplyBy(A);
+    // the sum of the row i to the slot d * i.
+    rotateSums(ea, v, d, 1, parallelism);
+    // gather the slots d * i to the slots i.
+    std::map<long, Vector<long>> gather;
+    for (long i = 0; i < d; i++) {
+        Vector<long> mask(n, 0);
+        mask[i] = 1;
+        gather.insert(std::make_pair((d - 1) * i, mask));
+    }
+    linearTransform(v, gather, ea, parallelism);
+}
+} // namespace MDL
@@ -0,0 +1,40 @@
+#ifndef ALGEBRA_MATRIXPRODUCT_HPP
+#define ALGEBRA_MATRIXPRODUCT_HPP
+#include "Matrix.hpp"
+#include "Vector.hpp"
+class Ctxt;
+class EncryptedArray;
+namespace MDL {
+/// Products of d x d matrices in FLAT_PACKING, i.e. the entry (i, j) in
+/// the slot d * i + j of one ciphertext. Needs d * d <= ea.size().
+///
+/// A * B = sum_{k < d} phi^k(sigma(A)) * psi^k(tau(B)) (Jiang et al.,
+/// "Secure Outsourced Matrix Computation and Application to Neural
+/// Networks", CCS 2018) where
+///   sigma(A)[i][j] = A[i][i + j],  tau(B)[i][j] = B[i + j][j],
+///   phi(A)[i][j]   = A[i][j + 1],  psi(B)[i][j] = B[i + 1][j],
+/// all indices modulo d. Each permutation is a linear transform of the
+/// slots. The depth is two plaintext multiplications and one ciphertext
+/// multiplication, and the d terms are independent.
+
+/// @return the row-major layout of a square matrix.
+inline Vector<long> flatten(const Matrix<long> &mat) { return mat.vector(); }
+
+/// A = A * B.
+/// @param parallelism. The threads the d terms may use.
+void matrixProduct(Ctxt &A,
+                   const Ctxt &B,
+                   long d,
+                   const EncryptedArray &ea,
+                   long parallelism = 1);
+
+/// v = A * v where v holds a vector in its first d slots and zeros in
+/// the others, the result is laid out the same way.
+/// @param parallelism. The threads the rotations may use.
+void matrixVectorProduct(Ctxt &v,
+                         const Ctxt &A,
+                         long d,
+                         const EncryptedArray &ea,
+                         long parallelism = 1);
+} // namespace MDL
+#endif // algebra/MatrixProduct.hpp
@@ -4,12 +4,7 @@
 #include <NTL/ZZ.h>
 #include <cmath>
 #include <vector>
-#include <thread>
-#ifdef FHE_THREADS
-const long WORKER_NR = 8;
-#else
-const long WORKER_NR = 1;
-#endif
+#include "MPParallel.hpp"
 
 static long getSlots(long m, long p)
 {
@@ -79,40 +74,18 @@ static std::set<long> FindPrimes(long m, long p, long parts)
 		m_primes.push_back(prime);
 	}
 
-	std::vector<std::thread> worker;
-	std::atomic<size_t> counter(0);
 	const size_t num = m_primes.size();
-	auto job = [this, &counter, &m, &r, &num]() {
-		size_t i;
-		while ((i = counter.fetch_add(1)) < num) {
-			contexts[i] = std::make_shared<FHEcontext>(m, m_primes[i], r);
-		}
-	};
-
 	contexts.resize(num);
-
-	for (long wr = 0; wr < WORKER_NR; wr++) worker.push_back(std::thread(job));
-
-	for (auto &&wr : worker) wr.join();
+	forEachIndex(num, [this, &m, &r](long i) {
+		contexts[i] = std::make_shared<FHEcontext>(m, m_primes[i], r);
+	});
 }
 
 void MPContext::buildModChain(long L)
 {
-	std::vector<std::thread> worker;
-	std::atomic<size_t> counter(0);
-	const size_t num = contexts.size();
-	auto job = [this, &counter, &num, &L]() {
-		size_t i;
-		while ((i = counter.fetch_add(1)) < num) {
-			::buildModChain(*contexts[i], L);
-		}
-	};
-
-	contexts.resize(num);
-
-	for (long wr = 0; wr < WORKER_NR; wr++) worker.push_back(std::thread(job));
-
-	for (auto &&wr : worker) wr.join();
+	forEachIndex(contexts.size(), [this, &L](long i) {
+		::buildModChain(*contexts[i], L);
+	});
 }
 
 double MPContext::precision() const
@@ -4,6 +4,9 @@
 #include <memory>
 #include <NTL/ZZ.h>
 #include <iostream>
+#include <vector>
+class MPPubKey;
+class MPSecKey;
 /// MultiPrecision FHEcontext
 class MPContext {
 public:
@@ -26,6 +29,12 @@ public:
 
     long getR() const { return m_r; }
 private:
+    MPContext() {}
+
+    friend bool readKeys(std::istream &, std::shared_ptr<MPContext> &,
+                         std::shared_ptr<MPPubKey> &,
+                         std::shared_ptr<MPSecKey> &);
+
     ZZ m_plainSpace = NTL::to_ZZ(1);
     long m_r = 1;
     std::vector<long> m_primes;
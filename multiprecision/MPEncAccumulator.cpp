@@ -0,0 +1,58 @@
+#include "MPEncAccumulator.hpp"
+#include "MPPubKey.hpp"
+#include "MPParallel.hpp"
+#include "fhe/Ctxt.h"
+MPEncAccumulator::MPEncAccumulator(const MPPubKey &pk)
+    : sum(pk),
+      started(pk.keyNum(), 0)
+{
+}
+
+void MPEncAccumulator::addProduct(const MPEncVector &a, const MPEncVector &b)
+{
+    if (a.partsNum() != sum.partsNum() || b.partsNum() != sum.partsNum()) {
+        printf("Warnning! MPEncAccumulator addProduct!\n");
+        return;
+    }
+
+    if (sum.getLength() < 0) sum.setLength(a.getLength());
+    forEachIndex(sum.partsNum(), [this, &a, &b](long i) {
+        addProduct(i, a.get(i), b.get(i));
+    });
+}
+
+void MPEncAccumulator::addProduct(long part, const Ctxt &a, const Ctxt &b)
+{
+    Ctxt &acc = sum.get(part);
+    if (!started[part]) {
+        acc = a;
+        acc *= b;
+        started[part] = 1;
+    } else {
+        Ctxt tmp(a);
+        tmp *= b;
+        acc += tmp;
+    }
+}
+
+void MPEncAccumulator::add(const MPEncVector &a)
+{
+    if (a.partsNum() != sum.partsNum()) {
+        printf("Warnning! MPEncAccumulator add!\n");
+        return;
+    }
+
+    if (sum.getLength() < 0) sum.setLength(a.getLength());
+    forEachIndex(sum.partsNum(), [this, &a](long i) {
+        Ctxt &acc = sum.get(i);
+        if (!started[i]) acc = a.get(i);
+        else acc += a.get(i);
+        started[i] = 1;
+    });
+}
+
+MPEncVector MPEncAccumulator::result()
+{
+    sum.reLinearize();
+    return sum;
+}
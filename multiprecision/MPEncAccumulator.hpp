@@ -0,0 +1,31 @@
+#ifndef MULTIPRECISION_MPENCACCUMULATOR_HPP
+#define MULTIPRECISION_MPENCACCUMULATOR_HPP
+#include "MPEncVector.hpp"
+#include <vector>
+class Ctxt;
+class MPPubKey;
+/// @brief Sum of ciphertext products kept unrelinearized.
+/// Each product stays in the 3-part form and the sum is relinearized
+/// once by result(), which saves a key-switching per term.
+/// The parts are independent: addProduct(part, ...) can be called
+/// concurrently for different parts, but not for the same part.
+class MPEncAccumulator {
+public:
+    explicit MPEncAccumulator(const MPPubKey &pk);
+
+    /// sum += a * b for every part.
+    void addProduct(const MPEncVector &a, const MPEncVector &b);
+
+    /// sum += a * b for one part.
+    void addProduct(long part, const Ctxt &a, const Ctxt &b);
+
+    /// sum += a for every part, a may be relinearized or not.
+    void add(const MPEncVector &a);
+
+    /// @return the relinearized sum.
+    MPEncVector result();
+private:
+    MPEncVector sum;
+    std::vector<char> started;
+};
+#endif // multiprecision/MPEncAccumulator.hpp
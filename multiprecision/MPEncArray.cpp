@@ -15,6 +15,7 @@ MPEncArray::MPEncArray(const MPContext &context)
             minimumSlot = arrays[i]->size();
         }
     }
+    m_basis = MDL::CRTBasis(rPrimes());
 }
 
 std::vector<long> MPEncArray::rPrimes() const
@@ -1,6 +1,7 @@
 #ifndef MULTIPRECISION_MPENCARRAY_HPP
 #define MULTIPRECISION_MPENCARRAY_HPP
 #include "fhe/EncryptedArray.h"
+#include "algebra/CRT.hpp"
 #include <vector>
 #include <memory>
 class MPContext;
@@ -20,11 +21,15 @@ public:
     std::vector<long> rPrimes() const ;
 
     NTL::ZZ plainSpace() const { return m_plainSpace; }
+
+    /// The CRT basis of rPrimes(), for combining the decrypted parts.
+    const MDL::CRTBasis& crtBasis() const { return m_basis; }
 private:
     long minimumSlot = 0;
     long m_r = 1;
     NTL::ZZ m_plainSpace;
     std::vector<long> m_primes;
     std::vector<encArrayPtr> arrays;
+    MDL::CRTBasis m_basis;
 };
 #endif // multiprecision/MPEncArray.hpp
@@ -2,28 +2,58 @@
 #include "MPPubKey.hpp"
 #include "MPSecKey.hpp"
 #include "MPEncArray.hpp"
+#include "MPEncodedVector.hpp"
+#include "MPEncAccumulator.hpp"
 #include "MPReplicate.h"
 #include "MPRotate.h"
+#include "MPParallel.hpp"
+#include "algebra/MatrixProduct.hpp"
+#include <algorithm>
 #include <map>
-#ifdef FHE_THREADS
-const long WORKER_NR = 8;
-#else
-const long WORKER_NR = 1;
-#endif
 
 MPEncMatrix::MPEncMatrix(const std::vector<MPEncVector> &copy) { ctxts = copy; }
 
 void MPEncMatrix::pack(const MDL::Matrix<long> &mat,
                        const MPPubKey &pk,
-                       const MPEncArray &ea)
+                       const MPEncArray &ea,
+                       MDL::MatrixPacking packing)
 {
-    auto rows = mat.rows();
-    ctxts.resize(rows, pk);
+    this->packing = packing;
+    rows = mat.rows();
+    columns = mat.cols();
+    offsets.clear();
+    if (packing == MDL::FLAT_PACKING &&
+        (rows != columns || rows * rows > ea.slots())) {
+        printf("Warnning! FLAT_PACKING needs a square matrix of at most "
+               "%ld entries, packing row-wisely\n", ea.slots());
+        this->packing = packing = MDL::ROW_PACKING;
+    }
 
-    for (long r = 0; r < rows; r++) {
-        ctxts[r].pack(mat[r], ea);
+    if (packing == MDL::FLAT_PACKING) {
+        ctxts.resize(1, pk);
+        ctxts[0].pack(MDL::flatten(mat), ea);
+        return;
     }
-    columns = mat.cols();
+
+    if (packing == MDL::ROW_PACKING) {
+        ctxts.resize(rows, pk);
+        forEachIndex(rows, [this, &mat, &ea](long r) {
+            ctxts[r].pack(mat[r], ea);
+        });
+        return;
+    }
+
+    // keep the all-zero diagonals too, the layout should not depend
+    // on the values.
+    std::vector<MDL::Vector<long>> diags;
+    for (auto &kv : MDL::diagonals(mat, ea.slots(), false)) {
+        offsets.push_back(kv.first);
+        diags.push_back(kv.second);
+    }
+    ctxts.resize(diags.size(), pk);
+    forEachIndex(diags.size(), [this, &diags, &ea](long d) {
+        ctxts[d].pack(diags[d], ea);
+    });
 }
 
 void MPEncMatrix::unpack(MDL::Matrix<NTL::ZZ> &result,
@@ -31,31 +61,69 @@ void MPEncMatrix::unpack(MDL::Matrix<NTL::ZZ> &result,
                          const MPEncArray &ea,
                          bool negate)
 {
-    const long rows = rowsNum();
-    result.resize(rows);
+    const long num = rowsNum();
+    MDL::Matrix<NTL::ZZ> unpacked(num);
 
-    for (long r = 0; r < rows; r++) {
-        ctxts[r].unpack(result[r], sk, ea, negate);
+    forEachIndex(num, [this, &unpacked, &sk, &ea, negate](long r) {
+        ctxts[r].unpack(unpacked[r], sk, ea, negate);
+    });
+
+    if (packing == MDL::ROW_PACKING) {
+        result.swap(unpacked);
+        return;
     }
+
+    if (packing == MDL::FLAT_PACKING) {
+        const auto &flat = unpacked[0];
+        result.resize(rows);
+        for (long r = 0; r < rows; r++)
+            result[r].assign(flat.begin() + r * columns,
+                             flat.begin() + (r + 1) * columns);
+        return;
+    }
+
+    std::map<long, MDL::Vector<NTL::ZZ>> diags;
+    for (long d = 0; d < num; d++)
+        diags[offsets[d]].swap(unpacked[d]);
+    result = MDL::fromDiagonals(diags, rows, columns);
 }
 
 MPEncVector MPEncMatrix::sDot(const MPEncVector &oth,
                               const MPPubKey &pk,
                               const MPEncArray &ea) const
 {
-    std::vector<MPEncVector> parts(rowsNum(), pk);
-    for (long c = 0; c < rowsNum(); c++) {
-        auto tmp(oth);
-        replicate(tmp, ea, c);
-        tmp.multiplyBy(ctxts[c]);
-        parts[c] = tmp;
+    if (packing == MDL::DIAGONAL_PACKING) {
+        MPEncVector result(oth);
+        long parallelism = partParallelism(result.partsNum());
+        forEachIndex(result.partsNum(), [&](long i) {
+            std::vector<const Ctxt *> diags;
+            for (auto &diag : ctxts) diags.push_back(&diag.get(i));
+            MDL::diagonalTransform(result.get(i), diags, offsets,
+                                   *ea.get(i), parallelism);
+        });
+        return result;
     }
 
-    for (long c = 1; c < rowsNum(); c++) {
-        parts[0] += parts[c];
+    if (packing == MDL::FLAT_PACKING) {
+        MPEncVector result(oth);
+        long parallelism = partParallelism(result.partsNum());
+        forEachIndex(result.partsNum(), [&](long i) {
+            MDL::matrixVectorProduct(result.get(i), ctxts[0].get(i), rows,
+                                     *ea.get(i), parallelism);
+        });
+        return result;
     }
 
-    return parts[0];
+    // sum_c replicate(oth, c) * row_c, part by part.
+    MPEncAccumulator acc(pk);
+    replicateAll(oth, ea, rowsNum(),
+                 [this, &acc](long i, long c, const Ctxt &replica) {
+        acc.addProduct(i, replica, ctxts[c].get(i));
+    });
+
+    auto result = acc.result();
+    result.setLength(oth.getLength());
+    return result;
 }
 
 // replicate 'd' copies of the 'vec'.
@@ -99,19 +167,19 @@ MPEncMatrix& MPEncMatrix::dot2(const MPEncMatrix &oth,
     if (columnToProces <= 0) columnToProces = ea.slots();
     auto rows = rowsNum();
 
-    for (long row = 0; row < rows; row++) {
-        MPEncVector oneRow(pk);
-
+    // rows run in parallel, each of them runs the per-prime work nested
+    // on the same pool.
+    std::vector<MPEncVector> result(rows, pk);
+    forEachIndex(rows, [&](long row) {
+        MPEncAccumulator acc(pk);
         for (long col = 0; col < columnToProces; col++) {
             auto tmp(ctxts[row]);
             replicate(tmp, ea, col);
-            tmp *= oth.ctxts[col];
-            if (col > 0) oneRow += tmp;
-            else oneRow = tmp;
+            acc.addProduct(tmp, oth.ctxts[col]);
         }
-        oneRow.reLinearize();
-        ctxts[row] = oneRow;
-    }
+        result[row] = acc.result();
+    });
+    ctxts.swap(result);
 
     return *this;
 }
@@ -121,22 +189,38 @@ MPEncMatrix& MPEncMatrix::dot(const MPEncMatrix &oth,
                               const MPPubKey &pk,
                               long columnToProces)
 {
+    // primes x terms of the product run in parallel.
+    if (packing == MDL::FLAT_PACKING && oth.packing == MDL::FLAT_PACKING &&
+        rows == oth.rows) {
+        long parallelism = partParallelism(ctxts[0].partsNum());
+        forEachIndex(ctxts[0].partsNum(), [&](long i) {
+            MDL::matrixProduct(ctxts[0].get(i), oth.ctxts[0].get(i), rows,
+                               *ea.get(i), parallelism);
+        });
+        return *this;
+    }
+
+    if (packing != MDL::ROW_PACKING || oth.packing != MDL::ROW_PACKING) {
+        printf("Warnning! MPEncMatrix dot needs row-packed matrices!\n");
+        return *this;
+    }
+
     if (columnToProces <= 0) columnToProces = ea.slots();
     auto rows = rowsNum();
 
-    for (long row = 0; row < rows; row++) {
-        MPEncVector oneRow(pk);
-
-        for (long col = 0; col < columnToProces; col++) {
-            auto tmp(ctxts[row]);
-            replicate(tmp, ea, col);
-            tmp *= oth.ctxts[col];
-            if (col > 0) oneRow += tmp;
-            else oneRow = tmp;
-        }
-        oneRow.reLinearize();
-        ctxts[row] = oneRow;
-    }
+    // rows run in parallel, each of them streams the replicas of its
+    // slots part by part on the same pool.
+    std::vector<MPEncVector> result(rows, pk);
+    forEachIndex(rows, [&](long row) {
+        MPEncAccumulator acc(pk);
+        replicateAll(ctxts[row], ea, columnToProces,
+                     [&acc, &oth](long i, long col, const Ctxt &replica) {
+            acc.addProduct(i, replica, oth.ctxts[col].get(i));
+        });
+        result[row] = acc.result();
+        result[row].setLength(ctxts[row].getLength());
+    });
+    ctxts.swap(result);
 
     return *this;
 }
@@ -150,9 +234,9 @@ MPEncMatrix& MPEncMatrix::addConstant(const MDL::Matrix<long> &con,
     }
 
     auto rows = con.rows();
-    for (long row = 0; row < rows; row++) {
+    forEachIndex(rows, [this, &con, &ea](long row) {
         ctxts[row].addConstant(con[row], ea);
-    }
+    });
 
     return *this;
 }
@@ -166,16 +250,44 @@ MPEncMatrix& MPEncMatrix::mulConstant(const MDL::Matrix<long> &con,
     }
 
     auto rows = con.rows();
-    for (long row = 0; row < rows; row++) {
+    forEachIndex(rows, [this, &con, &ea](long row) {
         ctxts[row].mulConstant(con[row], ea);
+    });
+
+    return *this;
+}
+
+MPEncMatrix& MPEncMatrix::addConstant(const std::vector<MPEncodedVector> &con)
+{
+    if (rowsNum() != con.size()) {
+        printf("Warnning! MPEncMatrix addConstant!\n");
+        return *this;
+    }
+
+    forEachIndex(rowsNum(), [this, &con](long row) {
+        ctxts[row].addConstant(con[row]);
+    });
+
+    return *this;
+}
+
+MPEncMatrix& MPEncMatrix::mulConstant(const std::vector<MPEncodedVector> &con)
+{
+    if (rowsNum() != con.size()) {
+        printf("Warnning! MPEncMatrix mulConstant!\n");
+        return *this;
     }
 
+    forEachIndex(rowsNum(), [this, &con](long row) {
+        ctxts[row].mulConstant(con[row]);
+    });
+
     return *this;
 }
 
 MPEncMatrix& MPEncMatrix::negate()
 {
-    for (auto &row : ctxts) row.negate();
+    forEachIndex(rowsNum(), [this](long r) { ctxts[r].negate(); });
     return *this;
 }
 
@@ -186,9 +298,9 @@ MPEncMatrix& MPEncMatrix::operator+=(const MPEncMatrix &oth)
         return *this;
     }
 
-    for (long r = 0; r < oth.rowsNum(); r++) {
+    forEachIndex(oth.rowsNum(), [this, &oth](long r) {
         ctxts[r] += oth.ctxts[r];
-    }
+    });
     return *this;
 }
 
@@ -199,20 +311,68 @@ MPEncMatrix& MPEncMatrix::operator-=(const MPEncMatrix &oth)
         return *this;
     }
 
-    for (long r = 0; r < oth.rowsNum(); r++) {
+    forEachIndex(oth.rowsNum(), [this, &oth](long r) {
         ctxts[r] -= oth.ctxts[r];
-    }
+    });
     return *this;
 }
 
+void MPEncMatrix::setLayout(long rows, long columns,
+                            MDL::MatrixPacking packing,
+                            const std::vector<long> &offsets)
+{
+    this->rows = rows;
+    this->columns = columns;
+    this->packing = packing;
+    this->offsets = offsets;
+}
+
+long MPEncMatrix::level() const
+{
+    long lvl = -1;
+    for (auto &row : ctxts) {
+        long l = row.level();
+        if (lvl < 0 || l < lvl) lvl = l;
+    }
+    return lvl;
+}
+
+long MPEncMatrix::reserveLevels(long needed)
+{
+    std::vector<long> dropped(rowsNum(), 0);
+    forEachIndex(rowsNum(), [this, needed, &dropped](long r) {
+        dropped[r] = ctxts[r].reserveLevels(needed);
+    });
+    return dropped.empty() ? 0 : *std::max_element(dropped.begin(), dropped.end());
+}
+
 MPEncMatrix mulMatrix(const MPEncVector &vec,
                       const MDL::Matrix<long> &mat,
                       const MPEncArray &ea)
 {
-    std::vector<MPEncVector> ctxts;
-    for (auto &row : mat) {
-        auto tmp(vec);
-        ctxts.push_back(tmp.mulConstant(row, ea));
-    }
+    std::vector<MPEncVector> ctxts(mat.rows(), vec);
+    forEachIndex(mat.rows(), [&ctxts, &mat, &ea](long r) {
+        ctxts[r].mulConstant(mat[r], ea);
+    });
     return MPEncMatrix(ctxts);
 }
+
+MPEncMatrix mulMatrix(const MPEncVector &vec,
+                      const std::vector<MPEncodedVector> &mat)
+{
+    std::vector<MPEncVector> ctxts(mat.size(), vec);
+    forEachIndex(mat.size(), [&ctxts, &mat](long r) {
+        ctxts[r].mulConstant(mat[r]);
+    });
+    return MPEncMatrix(ctxts);
+}
+
+void linearTransform(MPEncVector &vec,
+                     const MDL::Matrix<long> &mat,
+                     const MPEncArray &ea)
+{
+    long parallelism = partParallelism(vec.partsNum());
+    forEachIndex(vec.partsNum(), [&vec, &mat, &ea, parallelism](long i) {
+        MDL::linearTransform(vec.get(i), mat, *ea.get(i), parallelism);
+    });
+}
@@ -3,6 +3,7 @@
 #include "MPEncVector.hpp"
 #include "algebra/EncMatrix.hpp"
 #include "algebra/Matrix.hpp"
+#include "algebra/LinearTransform.hpp"
 #include <vector>
 #include <NTL/ZZ.h>
 #include <NTL/ZZX.h>
@@ -10,6 +11,7 @@
 class MPPubKey;
 class MPEncArray;
 class MPSecKey;
+class MPEncodedVector;
 
 class MPEncMatrix {
 public:
@@ -19,19 +21,25 @@ public:
 
     size_t rowsNum() const { return ctxts.size(); }
 
+    /// @param packing. With DIAGONAL_PACKING the i-th MPEncVector holds
+    ///                 the generalized diagonal of offset getOffsets()[i].
     void pack(const MDL::Matrix<long> &mat,
               const MPPubKey &pk,
-              const MPEncArray &ea);
+              const MPEncArray &ea,
+              MDL::MatrixPacking packing = MDL::ROW_PACKING);
 
     void unpack(MDL::Matrix<NTL::ZZ> &result,
                 const MPSecKey &sk,
                 const MPEncArray &ea,
                 bool negate = true);
-    /// assume that the matrix is symmetric
+    /// assume that the matrix is symmetric, unless it is DIAGONAL_PACKING
+    /// or FLAT_PACKING which compute the matrix-vector product for any matrix.
     MPEncVector sDot(const MPEncVector &oth,
                      const MPPubKey &pk,
                      const MPEncArray &ea) const;
 
+    /// Row-packed matrices multiply row by row, FLAT_PACKING matrices
+    /// use MDL::matrixProduct() with columnToProces ignored.
     MPEncMatrix& dot(const MPEncMatrix &oth,
                      const MPEncArray &ea,
                      const MPPubKey &pk,
@@ -50,6 +58,11 @@ public:
 
     MPEncMatrix& mulConstant(const NTL::ZZX &con);
 
+    /// constant operations with pre-encoded rows, see encodeRows().
+    MPEncMatrix& addConstant(const std::vector<MPEncodedVector> &con);
+
+    MPEncMatrix& mulConstant(const std::vector<MPEncodedVector> &con);
+
     MPEncMatrix& negate();
 
     MPEncMatrix& operator+=(const MPEncMatrix &oth);
@@ -61,8 +74,30 @@ public:
     long getColumns() const { return columns; }
 
     void setColumns(long c) { columns = c; }
+
+    MDL::MatrixPacking getPacking() const { return packing; }
+
+    const std::vector<long>& getOffsets() const { return offsets; }
+
+    /// @return the rows of the packed matrix, not the number of MPEncVector.
+    long getRows() const { return rows; }
+
+    /// Restore the layout of a matrix packed elsewhere, e.g. after its
+    /// ciphertexts were read back into this one.
+    void setLayout(long rows, long columns, MDL::MatrixPacking packing,
+                   const std::vector<long> &offsets);
+
+    /// @return the lowest level of the rows.
+    long level() const;
+
+    /// Mod-switch every row down to needed levels plus a margin.
+    /// @return the most levels dropped in one row.
+    long reserveLevels(long needed);
 private:
     long columns = -1;
+    long rows = -1;
+    MDL::MatrixPacking packing = MDL::ROW_PACKING;
+    std::vector<long> offsets;
     // MPPubKey &_pk;
     std::vector<MPEncVector> ctxts;
 };
@@ -70,4 +105,12 @@ private:
 MPEncMatrix mulMatrix(const MPEncVector &vec,
                       const MDL::Matrix<long> &mat,
                       const MPEncArray &ea);
+
+MPEncMatrix mulMatrix(const MPEncVector &vec,
+                      const std::vector<MPEncodedVector> &mat);
+
+/// vec = mat * vec for a plaintext matrix, see MDL::linearTransform().
+void linearTransform(MPEncVector &vec,
+                     const MDL::Matrix<long> &mat,
+                     const MPEncArray &ea);
 #endif // multiprecision/EncMatrix.hpp
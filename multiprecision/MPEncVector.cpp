@@ -2,14 +2,12 @@
 #include "MPPubKey.hpp"
 #include "MPSecKey.hpp"
 #include "MPEncArray.hpp"
+#include "MPEncodedVector.hpp"
 #include "algebra/CRT.hpp"
+#include "MPParallel.hpp"
+#include "utils/Levels.hpp"
+#include <algorithm>
 #include <vector>
-#include <thread>
-#ifdef FHE_THREADS
-const long WORKER_NR = 8;
-#else
-const long WORKER_NR = 1;
-#endif
 
 MPEncVector::MPEncVector(const MPPubKey &pk)
 {
@@ -24,9 +22,9 @@ void MPEncVector::pack(const MDL::Vector<long> &vec,
                        const MPEncArray &ea)
 {
     auto num = ea.arrayNum();
-    for (int i = 0; i < num; i++) {
+    forEachIndex(num, [this, &vec, &ea](long i) {
         ctxts[i].pack(vec, *ea.get(i));
-    }
+    });
     length = vec.dimension();
 }
 
@@ -37,84 +35,54 @@ void MPEncVector::unpack(MDL::Vector<NTL::ZZ> &vec,
 {
     auto slots = ea.slots();
     const auto num = ea.arrayNum();
-    auto rPrimes = ea.rPrimes();
     auto plainSpace = ea.plainSpace();
     std::vector<MDL::Vector<long>> tmps(num);
-    std::vector<std::thread> worker;
-    std::atomic<long> counter(0);
-    auto job = [this, &sk, &ea, &tmps, &num, &counter]() {
-       long i;
-       while ((i = counter.fetch_add(1)) < num) {
-           bool ok = ctxts[i].unpack(tmps[i], *sk.get(i), *ea.get(i));
-           if (!ok) printf("Warning! the decryption maybe incorrect!\n");
-       }
-    };
-
-    for (long wr = 0; wr < WORKER_NR; wr++) worker.push_back(std::thread(job));
-    for (auto &&wr : worker) wr.join();
-
-    vec.resize(slots);
+    forEachIndex(num, [this, &sk, &ea, &tmps](long i) {
+        bool ok = ctxts[i].unpack(tmps[i], *sk.get(i), *ea.get(i));
+        if (!ok) printf("Warning! the decryption maybe incorrect!\n");
+    });
+
+    std::vector<const long *> residues(num);
+    for (long i = 0; i < num; i++)
+        residues[i] = tmps[i].data();
+    ea.crtBasis().reconstruct(vec, residues, slots);
+    if (!negate) return;
+    const NTL::ZZ half = plainSpace >> 1;
     for (long s = 0; s < slots; s++) {
-        std::vector<long> values(num);
-        for (long i = 0; i < num; i++)
-            values[i] = tmps[i][s];
-
-        vec[s] = MDL::CRT<long, long>(values, rPrimes);
-        if (negate && vec[s] > (plainSpace >> 1)) {
+        if (vec[s] > half)
             vec[s] -= plainSpace;
-        }
     }
 }
 
 void MPEncVector::negate()
 {
-    for (auto &ctxt : ctxts) ctxt.negate();
+    forEachIndex(partsNum(), [this](long i) { ctxts[i].negate(); });
 }
 
 void MPEncVector::multiplyBy(const MPEncVector &oth)
 {
-    std::vector<std::thread> worker;
-    std::atomic<long> counter(0);
     const auto num = oth.ctxts.size();
-    auto job = [&counter, &num, this, &oth]() {
-        long i;
-        while ((i = counter.fetch_add(1)) < num) {
-            ctxts[i].multiplyBy(oth.ctxts[i]);
-        }
-    };
-
     if (num != ctxts.size()) {
         printf("Error! MPEncVectors multiplyBy!\n");
         return;
     }
 
-
-    for (long wr = 0; wr < WORKER_NR; wr++) worker.push_back(std::thread(job));
-
-    for (auto &&wr : worker) wr.join();
+    forEachIndex(num, [this, &oth](long i) {
+        ctxts[i].multiplyBy(oth.ctxts[i]);
+    });
 }
 
 MPEncVector& MPEncVector::operator*=(const MPEncVector &oth)
 {
-    std::vector<std::thread> worker;
-    std::atomic<long> counter(0);
     const auto num = oth.ctxts.size();
-    auto job = [&counter, &num, this, &oth]() {
-        long i;
-        while ((i = counter.fetch_add(1)) < num) {
-            ctxts[i] *= oth.ctxts[i];
-        }
-    };
-
     if (num != ctxts.size()) {
         printf("Error! MPEncVectors operator*=!\n");
         return *this;
     }
 
-
-    for (long wr = 0; wr < WORKER_NR; wr++) worker.push_back(std::thread(job));
-
-    for (auto &&wr : worker) wr.join();
+    forEachIndex(num, [this, &oth](long i) {
+        ctxts[i] *= oth.ctxts[i];
+    });
 
     return *this;
 }
@@ -127,9 +95,9 @@ MPEncVector& MPEncVector::operator+=(const MPEncVector &oth)
         return *this;
     }
 
-    for (long i = 0; i < num; i++) {
+    forEachIndex(num, [this, &oth](long i) {
         ctxts[i] += oth.ctxts[i];
-    }
+    });
 
     return *this;
 }
@@ -142,9 +110,9 @@ MPEncVector& MPEncVector::operator-=(const MPEncVector &oth)
         return *this;
     }
 
-    for (long i = 0; i < num; i++) {
+    forEachIndex(num, [this, &oth](long i) {
         ctxts[i] -= oth.ctxts[i];
-    }
+    });
 
     return *this;
 }
@@ -155,9 +123,10 @@ MPEncVector& MPEncVector::dot(const MPEncVector &oth,
     auto num = oth.ctxts.size();
     assert(num == ctxts.size());
 
-    for (long i = 0; i < num; i++) {
-       ctxts[i].dot(oth.ctxts[i], *ea.get(i));
-    }
+    long parallelism = partParallelism(num);
+    forEachIndex(num, [this, &oth, &ea, parallelism](long i) {
+       ctxts[i].dot(oth.ctxts[i], *ea.get(i), parallelism);
+    });
 
     return *this;
 }
@@ -170,19 +139,7 @@ MPEncVector& MPEncVector::addConstant(const MDL::Vector<long> &con,
         return *this;
     }
 
-    for (long i = 0; i < ea.arrayNum(); i++) {
-        NTL::ZZX poly;
-
-        if (ea.get(i)->size() > con.dimension()) {
-            auto tmp(con);
-            tmp.resize(ea.get(i)->size());
-            ea.get(i)->encode(poly, tmp);
-        } else {
-            ea.get(i)->encode(poly, con);
-        }
-        get(i).addConstant(poly);
-    }
-    return *this;
+    return addConstant(MPEncodedVector(con, ea));
 }
 
 MPEncVector& MPEncVector::mulConstant(const MDL::Vector<long> &con,
@@ -193,22 +150,55 @@ MPEncVector& MPEncVector::mulConstant(const MDL::Vector<long> &con,
         return *this;
     }
 
-    for (long i = 0; i < ea.arrayNum(); i++) {
-        NTL::ZZX poly;
-
-        if (ea.get(i)->size() > con.dimension()) {
-            auto tmp(con);
-            tmp.resize(ea.get(i)->size());
-            ea.get(i)->encode(poly, tmp);
-        } else {
-            ea.get(i)->encode(poly, con);
-        }
-        get(i).multByConstant(poly);
+    return mulConstant(MPEncodedVector(con, ea));
+}
+
+MPEncVector& MPEncVector::addConstant(const MPEncodedVector &con)
+{
+    if (con.partsNum() != partsNum()) {
+        printf("Warnning! MPEncVector addConstant!\n");
+        return *this;
     }
+
+    forEachIndex(partsNum(), [this, &con](long i) {
+        ctxts[i].addConstant(con.dcrt(i));
+    });
+    return *this;
+}
+
+MPEncVector& MPEncVector::mulConstant(const MPEncodedVector &con)
+{
+    if (con.partsNum() != partsNum()) {
+        printf("Warnning! MPEncVector mulConstant!\n");
+        return *this;
+    }
+
+    forEachIndex(partsNum(), [this, &con](long i) {
+        ctxts[i].multByConstant(con.dcrt(i));
+    });
     return *this;
 }
 
 void MPEncVector::reLinearize()
 {
-    for (auto &ctxt : ctxts) ctxt.reLinearize();
+    forEachIndex(partsNum(), [this](long i) { ctxts[i].reLinearize(); });
+}
+
+long MPEncVector::level() const
+{
+    long lvl = -1;
+    for (auto &ctxt : ctxts) {
+        long l = MDL::levels::level(ctxt);
+        if (lvl < 0 || l < lvl) lvl = l;
+    }
+    return lvl;
+}
+
+long MPEncVector::reserveLevels(long needed)
+{
+    std::vector<long> dropped(partsNum(), 0);
+    forEachIndex(partsNum(), [this, needed, &dropped](long i) {
+        dropped[i] = MDL::levels::reserve(ctxts[i], needed);
+    });
+    return dropped.empty() ? 0 : *std::max_element(dropped.begin(), dropped.end());
 }
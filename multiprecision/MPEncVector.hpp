@@ -7,6 +7,7 @@
 class MPSecKey;
 class MPPubKey;
 class MPEncArray;
+class MPEncodedVector;
 class MPEncVector {
 public:
     MPEncVector(const MPPubKey &pk);
@@ -39,12 +40,27 @@ public:
     MPEncVector& mulConstant(const MDL::Vector<long> &con,
                              const MPEncArray &ea);
 
+    /// constant operations with a pre-encoded plaintext.
+    MPEncVector& addConstant(const MPEncodedVector &con);
+
+    MPEncVector& mulConstant(const MPEncodedVector &con);
+
     size_t partsNum() const { return ctxts.size(); }
 
     MDL::EncVector& get(int index) { return ctxts[index]; }
 
+    const MDL::EncVector& get(int index) const { return ctxts[index]; }
+
     void reLinearize();
 
+    /// @return the lowest level of the parts.
+    long level() const;
+
+    /// Mod-switch every part down to needed levels plus a margin, see
+    /// MDL::levels::reserve().
+    /// @return the most levels dropped in one part.
+    long reserveLevels(long needed);
+
     long getLength() const { return length; }
 
     void setLength(long l) { length = l; }
@@ -0,0 +1,38 @@
+#include "MPEncodedVector.hpp"
+#include "MPEncArray.hpp"
+#include "MPParallel.hpp"
+MPEncodedVector::MPEncodedVector(const MDL::Vector<long> &vec,
+                                 const MPEncArray &ea)
+{
+    encode(vec, ea);
+}
+
+void MPEncodedVector::encode(const MDL::Vector<long> &vec,
+                             const MPEncArray &ea)
+{
+    auto num = ea.arrayNum();
+    polys.resize(num);
+    dcrts.resize(num);
+    forEachIndex(num, [this, &vec, &ea](long i) {
+        auto array = ea.get(i);
+        if (array->size() > vec.dimension()) {
+            auto tmp(vec);
+            tmp.resize(array->size());
+            array->encode(polys[i], tmp);
+        } else {
+            array->encode(polys[i], vec);
+        }
+        dcrts[i] = std::make_shared<DoubleCRT>(polys[i], array->getContext());
+    });
+    length = vec.dimension();
+}
+
+std::vector<MPEncodedVector> encodeRows(const MDL::Matrix<long> &mat,
+                                        const MPEncArray &ea)
+{
+    std::vector<MPEncodedVector> rows(mat.rows());
+    forEachIndex(mat.rows(), [&rows, &mat, &ea](long r) {
+        rows[r].encode(mat[r], ea);
+    });
+    return rows;
+}
@@ -0,0 +1,45 @@
+#ifndef MULTIPRECISION_MPENCODEDVECTOR_HPP
+#define MULTIPRECISION_MPENCODEDVECTOR_HPP
+#include "algebra/Vector.hpp"
+#include "algebra/Matrix.hpp"
+#include "fhe/DoubleCRT.h"
+#include <NTL/ZZX.h>
+#include <memory>
+#include <vector>
+class MPEncArray;
+/// @brief A plaintext vector encoded once for every prime of the
+/// MPContext. The constant operations of MPEncVector and MPEncMatrix
+/// accept it, so that a constant used repeatedly costs only the
+/// ciphertext-side addition or multiplication.
+class MPEncodedVector {
+public:
+    typedef std::shared_ptr<DoubleCRT> dcrtPtr;
+
+    MPEncodedVector() {}
+
+    MPEncodedVector(const MDL::Vector<long> &vec,
+                    const MPEncArray &ea);
+
+    /// Encode the vector, padded by zeros to the slots of each prime.
+    void encode(const MDL::Vector<long> &vec,
+                const MPEncArray &ea);
+
+    size_t partsNum() const { return polys.size(); }
+
+    const NTL::ZZX& poly(int index) const { return polys[index]; }
+
+    /// @return the encoding in DoubleCRT form over all the primes of
+    ///         the context, ready for Ctxt::addConstant/multByConstant.
+    const DoubleCRT& dcrt(int index) const { return *dcrts[index]; }
+
+    long getLength() const { return length; }
+private:
+    long length = -1;
+    std::vector<NTL::ZZX> polys;
+    std::vector<dcrtPtr> dcrts;
+};
+
+/// Encode every row of the matrix.
+std::vector<MPEncodedVector> encodeRows(const MDL::Matrix<long> &mat,
+                                        const MPEncArray &ea);
+#endif // multiprecision/MPEncodedVector.hpp
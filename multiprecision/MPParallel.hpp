@@ -0,0 +1,21 @@
+#ifndef MULTIPRECISION_MPPARALLEL_HPP
+#define MULTIPRECISION_MPPARALLEL_HPP
+#include "utils/Parallel.hpp"
+#include <algorithm>
+#include <functional>
+/// Run body(i) for every i in [0, n) on the shared pool, e.g. the CRT parts
+/// of a vector or the rows of a matrix. Loops nested inside body, like the
+/// per-part loops of a row, run on the same pool.
+inline void forEachIndex(long n, const std::function<void(long)> &body)
+{
+    MDL::parallel::parallel_for(MDL::parallel::MULTIPRECISION, n, body);
+}
+
+/// The threads each part may use for its own work (e.g. rotations)
+/// while all the parts run in parallel.
+inline long partParallelism(long parts)
+{
+    long threads = MDL::parallel::threads(MDL::parallel::MULTIPRECISION);
+    return std::max(1L, threads / std::max(1L, parts));
+}
+#endif // multiprecision/MPParallel.hpp
@@ -1,8 +1,10 @@
 #ifndef MULTIPRECISION_MPPUBKEY_HPP
 #define MULTIPRECISION_MPPUBKEY_HPP
 #include "fhe/FHE.h"
+#include <iostream>
 #include <vector>
 #include <memory>
+class MPContext;
 class MPSecKey;
 class MPPubKey {
 public:
@@ -13,6 +15,12 @@ public:
 
     size_t keyNum() const { return pkeys.size(); }
 private:
+    MPPubKey() {}
+
+    friend bool readKeys(std::istream &, std::shared_ptr<MPContext> &,
+                         std::shared_ptr<MPPubKey> &,
+                         std::shared_ptr<MPSecKey> &);
+
     std::vector<pubKeyPtr> pkeys;
 };
 #endif // multiprecision/MPPubKey.hpp
@@ -2,28 +2,28 @@
 #include "MPEncVector.hpp"
 #include "MPEncArray.hpp"
 #include "fhe/replicate.h"
-#include <vector>
-#include <thread>
-#ifdef FHE_THREADS
-const long WORKER_NR = 8;
-#else
-const long WORKER_NR = 1;
-#endif
+#include "MPParallel.hpp"
+#include "utils/FHEUtils.hpp"
 
 void replicate(MPEncVector &vec,
                const MPEncArray &ea,
                const long c)
 {
-    std::vector<std::thread> worker;
-    std::atomic<long> counter(0);
-    const long parts = vec.partsNum();
-    auto job = [&counter, &parts, &vec, &ea, &c]() {
-        long i;
-        while ((i = counter.fetch_add(1)) < parts) {
-            replicate(*ea.get(i), vec.get(i), c);
-        }
-    };
+    forEachIndex(vec.partsNum(), [&vec, &ea, &c](long i) {
+        replicate(*ea.get(i), vec.get(i), c);
+    });
+}
 
-    for (long wr = 0; wr < WORKER_NR; wr++) worker.push_back(std::thread(job));
-    for (auto &&wr : worker) wr.join();
+void replicateAll(const MPEncVector &vec,
+                  const MPEncArray &ea,
+                  long count,
+                  const MPReplicaHandler &handler)
+{
+    if (count <= 0 || count > ea.slots()) count = ea.slots();
+    forEachIndex(vec.partsNum(), [&vec, &ea, count, &handler](long i) {
+        replicateAll(*ea.get(i), vec.get(i), count,
+                     [i, &handler](long c, const Ctxt &replica) {
+            handler(i, c, replica);
+        });
+    });
 }
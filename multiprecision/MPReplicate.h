@@ -1,8 +1,24 @@
 #ifndef MULTIPRECISION_MPREPLICATE_H
 #define MULTIPRECISION_MPREPLICATE_H
+#include <functional>
 class MPEncVector;
 class MPEncArray;
+class Ctxt;
 void replicate(MPEncVector &vec,
                const MPEncArray &ea,
                const long c);
+
+/// Called with the part index, the slot index c and the part's replica
+/// of the c-th slot.
+typedef std::function<void(long, long, const Ctxt &)> MPReplicaHandler;
+
+/// Stream the replicas of the first count slots, see replicateAll() in
+/// utils/FHEUtils.hpp. The parts run in parallel, so handler is called
+/// concurrently for different parts; within one part the slots come in
+/// order.
+/// @param count: the number of replicas, 0 for ea.slots().
+void replicateAll(const MPEncVector &vec,
+                  const MPEncArray &ea,
+                  long count,
+                  const MPReplicaHandler &handler);
 #endif // multiprecision/MPReplicate.h
@@ -1,85 +1,43 @@
 #include "MPRotate.h"
 #include "Multiprecision.h"
-#include <thread>
+#include "MPParallel.hpp"
+#include "utils/FHEUtils.hpp"
 #include <vector>
 #include <map>
-#ifdef FHE_THREADS
-const long WORKER_NR = 8;
-#else
-const long WORKER_NR = 1;
-#endif
-
-static void totalSums(const EncryptedArray& ea, long blockSize, Ctxt& ctxt);
 
 void rotate(MPEncVector &vec,
             const MPEncArray &ea,
             const long r)
 {
     auto parts = vec.partsNum();
-    std::vector<std::thread> worker;
-    std::atomic<long> counter(0);
-    auto job = [&parts, &counter, &ea, &vec, &r]() {
-        long i;
-        while ((i = counter.fetch_add(1)) < parts) {
-            ea.get(i)->rotate(vec.get(i), r);
-        }
-    };
-
     if (parts != ea.arrayNum()) return;
 
-    for (long wr = 0; wr < WORKER_NR; wr++) {
-        worker.push_back(std::thread(job));
-    }
-
-    for (auto &&wr : worker) wr.join();
+    forEachIndex(parts, [&ea, &vec, &r](long i) {
+        ea.get(i)->rotate(vec.get(i), r);
+    });
 }
 
 void totalSums(MPEncVector &vec, const MPEncArray &ea, const long blockSize) {
     auto parts = vec.partsNum();
-    std::vector<std::thread> worker;
-    std::atomic<long> counter(0);
-    auto job = [&]() {
-        long i;
-        while ((i = counter.fetch_add(1)) < parts) {
-            totalSums(*ea.get(i), blockSize, vec.get(i));
-        }
-    };
-
     if (parts != ea.arrayNum()) return;
 
-    for (long wr = 0; wr < WORKER_NR; wr++) {
-        worker.push_back(std::thread(job));
-    }
-
-    for (auto &&wr : worker) wr.join();
+    long parallelism = partParallelism(parts);
+    forEachIndex(parts, [&ea, &vec, &blockSize, parallelism](long i) {
+        long n = (ea.get(i)->size() + blockSize - 1) / blockSize;
+        rotateSums(*ea.get(i), vec.get(i), n, blockSize, parallelism);
+    });
 }
 
-static void totalSums(const EncryptedArray& ea, long blockSize, Ctxt& ctxt) {
-    long n = ea.size();
-    n = (n + blockSize - 1) / blockSize;
-    if (n == 1) return;
-
-    Ctxt orig = ctxt;
-
-    long k = NumBits(n);
-    long e = 1;
-
-    for (long i = k-2; i >= 0; i--) {
-        Ctxt tmp1 = ctxt;
-        ea.rotate(tmp1, e * blockSize);
-        ctxt += tmp1; // ctxt = ctxt + (ctxt >>> e)
-        e = 2*e;
+void partialSums(MPEncVector &vec,
+                 const MPEncArray &ea,
+                 const long count,
+                 const long stride)
+{
+    auto parts = vec.partsNum();
+    if (parts != ea.arrayNum()) return;
 
-        if (bit(n, i)) {
-            Ctxt tmp2 = orig;
-            ea.rotate(tmp2, e * blockSize);
-            ctxt += tmp2; // ctxt = ctxt + (orig >>> e)
-            // NOTE: we could have also computed
-            // ctxt =  (ctxt >>> e) + orig, however,
-            // this would give us greater depth/noise
-            e += blockSize;
-        }
-    }
+    long parallelism = partParallelism(parts);
+    forEachIndex(parts, [&ea, &vec, count, stride, parallelism](long i) {
+        rotateSums(*ea.get(i), vec.get(i), count, stride, parallelism);
+    });
 }
-
-
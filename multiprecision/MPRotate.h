@@ -6,7 +6,15 @@ void rotate(MPEncVector &vec,
             const MPEncArray &ea,
             const long r);
 
+/// Sum the slots of the same residue class of blockSize.
 void totalSums(MPEncVector &vec,
                const MPEncArray &ea,
                const long blockSize = 1);
+
+/// slot j becomes the sum of the slots j, j + stride, ...,
+/// j + (count - 1) * stride. See rotateSums() in utils/FHEUtils.hpp.
+void partialSums(MPEncVector &vec,
+                 const MPEncArray &ea,
+                 const long count,
+                 const long stride = 1);
 #endif // multiprecision/MPRotate.h
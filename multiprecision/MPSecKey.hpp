@@ -1,9 +1,11 @@
 #ifndef MULTIPRECISION_MPSECKEY_HPP
 #define MULTIPRECISION_MPSECKEY_HPP
 #include "fhe/FHE.h"
+#include <iostream>
 #include <memory>
 #include <vector>
 class MPContext;
+class MPPubKey;
 class MPSecKey {
 public:
     typedef std::shared_ptr<FHESecKey> secKeyPtr;
@@ -13,6 +15,12 @@ public:
 
     size_t keyNum() const { return skeys.size(); }
 private:
+    MPSecKey() {}
+
+    friend bool readKeys(std::istream &, std::shared_ptr<MPContext> &,
+                         std::shared_ptr<MPPubKey> &,
+                         std::shared_ptr<MPSecKey> &);
+
     std::vector<secKeyPtr> skeys;
 };
 #endif // multiprecision/MPSecKey.hpp
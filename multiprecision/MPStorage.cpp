@@ -0,0 +1,191 @@
+#include "MPStorage.hpp"
+#include "MPContext.hpp"
+#include "MPSecKey.hpp"
+#include "MPPubKey.hpp"
+#include "MPEncVector.hpp"
+#include "MPEncMatrix.hpp"
+#include "MPParallel.hpp"
+#include "utils/BinaryIO.hpp"
+#include <atomic>
+#include <fstream>
+#include <sstream>
+#include <vector>
+using namespace MDL::binary;
+
+static const char KEYS_MAGIC[] = "MPKB";
+static const char VECTOR_MAGIC[] = "MPCV";
+static const char MATRIX_MAGIC[] = "MPCM";
+static const long VERSION = 1;
+
+void writeKeys(std::ostream &out,
+               const MPContext &context,
+               const MPPubKey &pk,
+               const MPSecKey *sk)
+{
+    const long parts = context.partsNum();
+    writeHeader(out, KEYS_MAGIC, VERSION);
+    writeLong(out, context.getR());
+    writeLongs(out, context.primes());
+    for (long i = 0; i < parts; i++) {
+        std::ostringstream sstream;
+        writeContextBase(sstream, *context.get(i));
+        sstream << *context.get(i);
+        writeBytes(out, sstream.str());
+    }
+
+    // the secret keys contain the public ones.
+    writeLong(out, sk != nullptr);
+    for (long i = 0; i < parts; i++) {
+        if (sk != nullptr) writeObject(out, *sk->get(i));
+        else writeObject(out, *pk.get(i));
+    }
+}
+
+bool readKeys(std::istream &in,
+              std::shared_ptr<MPContext> &context,
+              std::shared_ptr<MPPubKey> &pk,
+              std::shared_ptr<MPSecKey> &sk)
+{
+    long r, hasSecret;
+    std::vector<long> primes;
+    if (!readHeader(in, KEYS_MAGIC, VERSION) || !readLong(in, r) ||
+        !readLongs(in, primes)) {
+        fprintf(stderr, "Warnning! not a key bundle\n");
+        return false;
+    }
+
+    const long parts = primes.size();
+    std::vector<std::string> contextBytes(parts), keyBytes(parts);
+    for (auto &bytes : contextBytes)
+        if (!readBytes(in, bytes)) return false;
+    if (!readLong(in, hasSecret)) return false;
+    for (auto &bytes : keyBytes)
+        if (!readBytes(in, bytes)) return false;
+
+    auto ctx = std::shared_ptr<MPContext>(new MPContext());
+    ctx->m_r = r;
+    ctx->m_primes = primes;
+    ctx->contexts.resize(parts);
+    for (long prime : primes)
+        ctx->m_plainSpace *= NTL::power(NTL::to_ZZ(prime), r);
+
+    std::shared_ptr<MPSecKey> secret;
+    auto pub = std::shared_ptr<MPPubKey>(new MPPubKey());
+    if (hasSecret) secret = std::shared_ptr<MPSecKey>(new MPSecKey());
+    if (secret) secret->skeys.resize(parts);
+    pub->pkeys.resize(parts);
+
+    std::atomic<bool> ok(true);
+    forEachIndex(parts, [&](long i) {
+        std::istringstream sstream(contextBytes[i]);
+        unsigned long m, p, r;
+        readContextBase(sstream, m, p, r);
+        auto part = std::make_shared<FHEcontext>(m, p, r);
+        sstream >> *part;
+        ctx->contexts[i] = part;
+        if (secret) {
+            secret->skeys[i] = std::make_shared<FHESecKey>(*part);
+            if (!readObject(keyBytes[i], *secret->skeys[i])) ok = false;
+            pub->pkeys[i] = std::make_shared<FHEPubKey>(*secret->skeys[i]);
+        } else {
+            pub->pkeys[i] = std::make_shared<FHEPubKey>(*part);
+            if (!readObject(keyBytes[i], *pub->pkeys[i])) ok = false;
+        }
+    });
+
+    if (!ok) {
+        fprintf(stderr, "Warnning! broken key bundle\n");
+        return false;
+    }
+    context = ctx;
+    pk = pub;
+    sk = secret;
+    return true;
+}
+
+bool saveKeys(const std::string &file,
+              const MPContext &context,
+              const MPPubKey &pk,
+              const MPSecKey *sk)
+{
+    std::ofstream out(file, std::ios::binary);
+    if (!out.is_open()) {
+        fprintf(stderr, "Can not open file: %s\n", file.c_str());
+        return false;
+    }
+    writeKeys(out, context, pk, sk);
+    return static_cast<bool>(out);
+}
+
+bool loadKeys(const std::string &file,
+              std::shared_ptr<MPContext> &context,
+              std::shared_ptr<MPPubKey> &pk,
+              std::shared_ptr<MPSecKey> &sk)
+{
+    std::ifstream in(file, std::ios::binary);
+    if (!in.is_open()) return false;
+    return readKeys(in, context, pk, sk);
+}
+
+void writeVector(std::ostream &out, const MPEncVector &vec)
+{
+    writeHeader(out, VECTOR_MAGIC, VERSION);
+    writeLong(out, vec.getLength());
+    writeLong(out, vec.partsNum());
+    for (size_t i = 0; i < vec.partsNum(); i++)
+        writeObject(out, static_cast<const Ctxt &>(vec.get(i)));
+}
+
+bool readVector(std::istream &in, MPEncVector &vec)
+{
+    long length, parts;
+    if (!readHeader(in, VECTOR_MAGIC, VERSION) || !readLong(in, length) ||
+        !readLong(in, parts) || parts != static_cast<long>(vec.partsNum())) {
+        fprintf(stderr, "Warnning! not a ciphertext of this key\n");
+        return false;
+    }
+
+    std::vector<std::string> bytes(parts);
+    for (auto &b : bytes)
+        if (!readBytes(in, b)) return false;
+
+    std::atomic<bool> ok(true);
+    forEachIndex(parts, [&vec, &bytes, &ok](long i) {
+        Ctxt &ctxt = vec.get(i);
+        if (!readObject(bytes[i], ctxt)) ok = false;
+    });
+    vec.setLength(length);
+    return ok;
+}
+
+void writeMatrix(std::ostream &out, const MPEncMatrix &mat)
+{
+    writeHeader(out, MATRIX_MAGIC, VERSION);
+    writeLong(out, mat.getRows());
+    writeLong(out, mat.getColumns());
+    writeLong(out, mat.getPacking());
+    writeLongs(out, mat.getOffsets());
+    writeLong(out, mat.rowsNum());
+    for (size_t r = 0; r < mat.rowsNum(); r++) writeVector(out, mat.get(r));
+}
+
+bool readMatrix(std::istream &in, MPEncMatrix &mat, const MPPubKey &pk)
+{
+    long rows, columns, packing, num;
+    std::vector<long> offsets;
+    if (!readHeader(in, MATRIX_MAGIC, VERSION) || !readLong(in, rows) ||
+        !readLong(in, columns) || !readLong(in, packing) ||
+        !readLongs(in, offsets) || !readLong(in, num) || num < 0) {
+        fprintf(stderr, "Warnning! not an encrypted matrix\n");
+        return false;
+    }
+
+    std::vector<MPEncVector> ctxts(num, pk);
+    for (auto &row : ctxts)
+        if (!readVector(in, row)) return false;
+
+    mat = MPEncMatrix(ctxts);
+    mat.setLayout(rows, columns, static_cast<MDL::MatrixPacking>(packing),
+                  offsets);
+    return true;
+}
@@ -0,0 +1,47 @@
+#ifndef MULTIPRECISION_MPSTORAGE_HPP
+#define MULTIPRECISION_MPSTORAGE_HPP
+#include <iostream>
+#include <memory>
+#include <string>
+class MPContext;
+class MPSecKey;
+class MPPubKey;
+class MPEncVector;
+class MPEncMatrix;
+/// Binary files of the multiprecision key bundle and ciphertexts.
+/// Every file starts with a 4-byte magic and a format version, followed by
+/// the CRT primes and one length-prefixed section per prime, see
+/// utils/BinaryIO.hpp. The sections are parsed in parallel when loading.
+
+/// Write the contexts, the public keys and, if sk is given, the secret keys.
+void writeKeys(std::ostream &out,
+               const MPContext &context,
+               const MPPubKey &pk,
+               const MPSecKey *sk = nullptr);
+
+/// Read a key bundle. sk is reset if the bundle has no secret keys.
+/// @return false if the stream does not hold a key bundle.
+bool readKeys(std::istream &in,
+              std::shared_ptr<MPContext> &context,
+              std::shared_ptr<MPPubKey> &pk,
+              std::shared_ptr<MPSecKey> &sk);
+
+bool saveKeys(const std::string &file,
+              const MPContext &context,
+              const MPPubKey &pk,
+              const MPSecKey *sk = nullptr);
+
+bool loadKeys(const std::string &file,
+              std::shared_ptr<MPContext> &context,
+              std::shared_ptr<MPPubKey> &pk,
+              std::shared_ptr<MPSecKey> &sk);
+
+void writeVector(std::ostream &out, const MPEncVector &vec);
+
+/// @param vec. Constructed with the public key of the ciphertext.
+bool readVector(std::istream &in, MPEncVector &vec);
+
+void writeMatrix(std::ostream &out, const MPEncMatrix &mat);
+
+bool readMatrix(std::istream &in, MPEncMatrix &mat, const MPPubKey &pk);
+#endif // multiprecision/MPStorage.hpp
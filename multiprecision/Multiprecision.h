@@ -4,8 +4,11 @@
 #include "MPEncArray.hpp"
 #include "MPEncMatrix.hpp"
 #include "MPEncVector.hpp"
+#include "MPEncodedVector.hpp"
+#include "MPEncAccumulator.hpp"
 #include "MPPubKey.hpp"
 #include "MPReplicate.h"
 #include "MPSecKey.hpp"
+#include "MPStorage.hpp"
 #include "MPRotate.h"
 #endif // MULTIPRECISION_MULTIPRESION_H
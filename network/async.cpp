@@ -0,0 +1,140 @@
+#include "async.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+namespace MDL {
+namespace net {
+#ifdef USE_NETWORK
+AsyncChannel::AsyncChannel(int socket, size_t window)
+    : socket(socket), window(std::max<size_t>(window, 1))
+{
+    io = std::thread(&AsyncChannel::loop, this);
+}
+
+AsyncChannel::~AsyncChannel()
+{
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        stopping = true;
+    }
+    wakeup.notify_all();
+    io.join();
+}
+
+std::future<bool> AsyncChannel::post(std::function<bool()> op)
+{
+    auto task = std::make_shared<std::packaged_task<bool()>>(op);
+    auto future = task->get_future();
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        ops.push_back([task]() { (*task)(); });
+    }
+    wakeup.notify_one();
+    return future;
+}
+
+std::future<bool> AsyncChannel::send(std::vector<void *> data,
+                                     std::vector<size_t> lens)
+{
+    return post([this, data, lens]() {
+        return sendChunks(data, lens);
+    });
+}
+
+std::future<bool> AsyncChannel::receive(std::vector<size_t> lens,
+                                        ElementConsumer consume)
+{
+    return post([this, lens, consume]() {
+        return drainAcks() && receive_all(socket, lens, consume);
+    });
+}
+
+void AsyncChannel::send(std::vector<void *> data,
+                        std::vector<size_t> lens,
+                        Callback done)
+{
+    post([this, data, lens, done]() {
+        bool ok = sendChunks(data, lens);
+        if (done) done(ok);
+        return ok;
+    });
+}
+
+void AsyncChannel::receive(std::vector<size_t> lens,
+                           ElementConsumer consume,
+                           Callback done)
+{
+    post([this, lens, consume, done]() {
+        bool ok = drainAcks() && receive_all(socket, lens, consume);
+        if (done) done(ok);
+        return ok;
+    });
+}
+
+bool AsyncChannel::sendChunks(const std::vector<void *> &data,
+                              const std::vector<size_t> &lens)
+{
+    if (broken) return false;
+    std::vector<struct nn_iovec> iov(std::min(data.size(), MAX_ELEMENT_NR));
+    struct nn_msghdr hdr;
+    std::memset(&hdr, 0, sizeof hdr);
+    hdr.msg_iov = iov.data();
+    for (size_t first = 0; first < data.size(); first += MAX_ELEMENT_NR) {
+        if (unacked == window) {
+            if (nn_recv(socket, NULL, 0, 0) < 0) {
+                printf("ack error %s\n", nn_strerror(nn_errno()));
+                broken = true;
+                return false;
+            }
+            unacked -= 1;
+        }
+
+        size_t msg_nr = std::min(data.size() - first, MAX_ELEMENT_NR);
+        for (size_t j = 0; j < msg_nr; j++) {
+            iov[j].iov_base = data[first + j];
+            iov[j].iov_len = lens[first + j];
+        }
+        hdr.msg_iovlen = msg_nr;
+        if (nn_sendmsg(socket, &hdr, 0) < 0) {
+            printf("send error %s\n", nn_strerror(nn_errno()));
+            broken = true;
+            return false;
+        }
+        unacked += 1;
+    }
+    return true;
+}
+
+bool AsyncChannel::drainAcks()
+{
+    if (broken) return false;
+    while (unacked > 0) {
+        if (nn_recv(socket, NULL, 0, 0) < 0) {
+            printf("ack error %s\n", nn_strerror(nn_errno()));
+            broken = true;
+            return false;
+        }
+        unacked -= 1;
+    }
+    return true;
+}
+
+void AsyncChannel::loop()
+{
+    for (;;) {
+        std::function<void()> op;
+        {
+            std::unique_lock<std::mutex> lock(mtx);
+            wakeup.wait(lock, [this]() { return stopping || !ops.empty(); });
+            if (ops.empty()) break;
+            op = std::move(ops.front());
+            ops.pop_front();
+        }
+        op();
+    }
+    drainAcks();
+}
+#endif
+} // namespace net
+} // namespace MDL
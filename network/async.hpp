@@ -0,0 +1,83 @@
+#ifndef NETWORK_ASYNC_HPP
+#define NETWORK_ASYNC_HPP
+#include "network.hpp"
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+namespace MDL {
+namespace net {
+#ifdef USE_NETWORK
+/// @brief Asynchronous transfers on one socket.
+/// An I/O thread runs the queued sends and receives in order, so the caller
+/// keeps computing meanwhile, e.g. encrypting batch k + 1 while batch k is
+/// in flight, or accumulating the first received batch while the later ones
+/// arrive. Queued sends share one window: the chunks of the next send go
+/// out while the acks of the previous one are still pending. The pending
+/// acks are collected before a receive and when the channel is destroyed.
+class AsyncChannel {
+public:
+    /// Called with false if the transfer failed.
+    typedef std::function<void(bool)> Callback;
+
+    /// @param window. Chunks in flight, see send_all(). Larger than 1 needs
+    ///                NN_PAIR sockets.
+    explicit AsyncChannel(int socket, size_t window = 1);
+
+    /// Finishes the queued transfers.
+    ~AsyncChannel();
+
+    AsyncChannel(const AsyncChannel &oth) = delete;
+
+    AsyncChannel& operator=(const AsyncChannel &oth) = delete;
+
+    /// Queue a send. The data must stay valid until the future is ready,
+    /// i.e. until every chunk has been handed to nanomsg; its acks may still
+    /// be pending. The future holds false if the transfer failed.
+    std::future<bool> send(std::vector<void *> data,
+                           std::vector<size_t> lens);
+
+    /// Queue a receive. consume() runs on the I/O thread for every element
+    /// as soon as its chunk has arrived, hand long work off to a pool.
+    std::future<bool> receive(std::vector<size_t> lens,
+                              ElementConsumer consume);
+
+    /// The callback versions, done() runs on the I/O thread.
+    void send(std::vector<void *> data,
+              std::vector<size_t> lens,
+              Callback done);
+
+    void receive(std::vector<size_t> lens,
+                 ElementConsumer consume,
+                 Callback done);
+private:
+    std::future<bool> post(std::function<bool()> op);
+
+    void loop();
+
+    /// Send the chunks, waiting for an ack whenever the window is full.
+    bool sendChunks(const std::vector<void *> &data,
+                    const std::vector<size_t> &lens);
+
+    /// Collect the acks of the chunks in flight.
+    bool drainAcks();
+
+    int socket;
+    size_t window;
+    /// Chunks sent but not acked yet, only touched by the I/O thread.
+    size_t unacked = 0;
+    /// Set once a transfer failed, the later ones fail too.
+    bool broken = false;
+    std::mutex mtx;
+    std::condition_variable wakeup;
+    std::deque<std::function<void()>> ops;
+    bool stopping = false;
+    std::thread io;
+};
+#endif
+} // namespace net
+} // namespace MDL
+#endif // NETWORK_ASYNC_HPP
@@ -1,6 +1,9 @@
 #include "network.hpp"
+#include "utils/Wire.hpp"
+#include "fhe/Ctxt.h"
 #include <nanomsg/nn.h>
 #include <stdio.h>
+#include <algorithm>
 #include <cstring>
 namespace MDL {
 namespace net {
@@ -37,11 +40,12 @@ size_t make_nn_header(struct nn_msghdr *hdr,
     return msg_nr;
 }
 
-void send_all(int socket,
+bool send_all(int socket,
               const std::vector<void *> &data,
               const std::vector<size_t> &lens) {
 	struct nn_msghdr hdr;
 	size_t to_send = data.size();
+	bool ok = true;
 
 	std::memset(&hdr, 0, sizeof hdr);
     	hdr.msg_iov = (struct nn_iovec *)nn_allocmsg(sizeof(struct nn_iovec) * MAX_ELEMENT_NR, 0);
@@ -54,21 +58,95 @@ void send_all(int socket,
 			hdr.msg_iov[j].iov_len = lens[i + j];
 		}
 		hdr.msg_iovlen = msg_nr;
-		nn_sendmsg(socket, &hdr, 0);
-		nn_recv(socket, NULL, 0, 0);
+		if (nn_sendmsg(socket, &hdr, 0) < 0 || nn_recv(socket, NULL, 0, 0) < 0) {
+			printf("send error %s\n", nn_strerror(nn_errno()));
+			ok = false;
+			break;
+		}
 		i += msg_nr;
 		to_send -= msg_nr;
 		msg_nr = std::min(to_send, MAX_ELEMENT_NR);
 	}
-	printf("sent all!\n");
+	if (ok) printf("sent all!\n");
+	nn_freemsg(hdr.msg_iov);
+	return ok;
+}
+
+bool send_all(int socket,
+              const std::vector<void *> &data,
+              const std::vector<size_t> &lens,
+              size_t window) {
+	size_t chunks = (data.size() + MAX_ELEMENT_NR - 1) / MAX_ELEMENT_NR;
+	return send_stream(socket, chunks,
+	                   [&data, &lens](size_t chunk, std::vector<void *> &d,
+	                                  std::vector<size_t> &l) {
+		size_t first = chunk * MAX_ELEMENT_NR;
+		size_t last = std::min(first + MAX_ELEMENT_NR, data.size());
+		d.assign(data.begin() + first, data.begin() + last);
+		l.assign(lens.begin() + first, lens.begin() + last);
+	}, window);
+}
+
+bool send_stream(int socket,
+                 size_t chunks,
+                 const ChunkProducer &produce,
+                 size_t window) {
+	struct nn_msghdr hdr;
+	std::vector<void *> data;
+	std::vector<size_t> lens;
+	size_t in_flight = 0;
+	bool ok = true;
+
+	window = std::max<size_t>(window, 1);
+	std::memset(&hdr, 0, sizeof hdr);
+	hdr.msg_iov = (struct nn_iovec *)nn_allocmsg(sizeof(struct nn_iovec) * MAX_ELEMENT_NR, 0);
+	for (size_t c = 0; c < chunks && ok; c++) {
+		data.clear();
+		lens.clear();
+		produce(c, data, lens);
+		if (in_flight == window) {
+			if (nn_recv(socket, NULL, 0, 0) < 0) {
+				printf("ack error %s\n", nn_strerror(nn_errno()));
+				ok = false;
+				break;
+			}
+			in_flight -= 1;
+		}
+
+		size_t msg_nr = std::min(data.size(), MAX_ELEMENT_NR);
+		for (size_t j = 0; j < msg_nr; j++) {
+			hdr.msg_iov[j].iov_base = data[j];
+			hdr.msg_iov[j].iov_len = lens[j];
+		}
+		hdr.msg_iovlen = msg_nr;
+		if (nn_sendmsg(socket, &hdr, 0) < 0) {
+			printf("send error %s\n", nn_strerror(nn_errno()));
+			ok = false;
+			break;
+		}
+		in_flight += 1;
+	}
+
+	// the chunks that made it out are still acked.
+	while (in_flight > 0) {
+		if (nn_recv(socket, NULL, 0, 0) < 0) {
+			printf("ack error %s\n", nn_strerror(nn_errno()));
+			ok = false;
+			break;
+		}
+		in_flight -= 1;
+	}
 	nn_freemsg(hdr.msg_iov);
+	return ok;
 }
 
-void receive_all(int socket,
-                 const std::vector<size_t> &lens) {
+bool receive_all(int socket,
+                 const std::vector<size_t> &lens,
+                 const ElementConsumer &consume) {
 	struct nn_msghdr hdr;
 	size_t to_receive = lens.size();
 	size_t msg_nr = std::min(to_receive, MAX_ELEMENT_NR);
+	bool ok = true;
 
 	std::memset(&hdr, 0, sizeof hdr);
     	hdr.msg_iov = (struct nn_iovec *)nn_allocmsg(sizeof(struct nn_iovec) * MAX_ELEMENT_NR, 0);
@@ -90,14 +168,32 @@ void receive_all(int socket,
 			hdr.msg_iov[j].iov_len = lens[i + j];
 		}
 		hdr.msg_iovlen = msg_nr;
-		nn_recvmsg(socket, &hdr, 0);
-		nn_send(socket, NULL, 0, 0);
+		if (nn_recvmsg(socket, &hdr, 0) < 0) {
+			printf("receive error %s\n", nn_strerror(nn_errno()));
+			ok = false;
+			break;
+		}
+		// ack first, a pipelined sender keeps sending while we consume.
+		if (nn_send(socket, NULL, 0, 0) < 0) {
+			printf("ack error %s\n", nn_strerror(nn_errno()));
+			ok = false;
+			break;
+		}
+		if (consume) {
+			for (size_t j = 0; j < msg_nr; j++)
+				consume(i + j, hdr.msg_iov[j].iov_base, lens[i + j]);
+		}
 		i += msg_nr;
 		to_receive -= msg_nr;
 		msg_nr = std::min(to_receive, MAX_ELEMENT_NR);
 	}
-	printf("receive all!\n");
+	if (ok) printf("receive all!\n");
+	for (size_t j = 0; j < MAX_ELEMENT_NR; j++) {
+		if (hdr.msg_iov[j].iov_base != NULL)
+			nn_freemsg(hdr.msg_iov[j].iov_base);
+	}
 	nn_freemsg(hdr.msg_iov);
+	return ok;
 }
 
 size_t make_nn_header(struct nn_msghdr *hdr,
@@ -120,6 +216,23 @@ void free_header(struct nn_msghdr *hdr, bool free_base) {
     nn_freemsg(hdr->msg_iov);
 }
 
+void *encode_message(const Ctxt &ctxt, size_t &len, long needed) {
+    if (needed >= 0) {
+        Ctxt compacted = wire::compact(ctxt, needed);
+        return encode_message(compacted, len);
+    }
+    size_t capacity = wire::estimatedSize(ctxt);
+    char *msg = (char *)nn_allocmsg(capacity, 0);
+    len = wire::encode(ctxt, msg, capacity, [](char *old, size_t size) {
+        return (char *)nn_reallocmsg(old, size);
+    });
+    return msg;
+}
+
+bool decode_message(Ctxt &ctxt, const void *msg, size_t len) {
+    return wire::decode(ctxt, msg, len) > 0;
+}
+
 void free_header(struct msg_header *hdr) {
     nn_freemsg(hdr);
 }
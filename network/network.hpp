@@ -1,8 +1,19 @@
 #ifndef NETWORK_NETWORK_HPP
 #define NETWORK_NETWORK_HPP
+#include <functional>
 #include <vector>
 #include <nanomsg/nn.h>
+class Ctxt;
+class FHEPubKey;
+class MPPubKey;
+class MPEncVector;
+class MPEncMatrix;
 namespace MDL {
+class EncVector;
+namespace Paillier {
+class PubKey;
+class Ctxt;
+} // namespace Paillier
 namespace net {
 #ifdef USE_NETWORK
 const size_t MAX_ELEMENT_NR = 500;
@@ -27,18 +38,87 @@ void free_header(msg_header *hdr);
 
 void free_header(struct nn_msghdr *hdr, bool free_base);
 
-void receive_all(int socket,
-                 const std::vector<size_t> &lens);
+/// Fills the data and lens of the chunk-th chunk, at most MAX_ELEMENT_NR
+/// elements.
+typedef std::function<void(size_t chunk,
+                           std::vector<void *> &data,
+                           std::vector<size_t> &lens)> ChunkProducer;
 
-void send_all(int socket,
+/// Called with every received element, data is only valid in the call.
+typedef std::function<void(size_t index,
+                           const void *data,
+                           size_t len)> ElementConsumer;
+
+/// The receiver acks every chunk of MAX_ELEMENT_NR elements.
+/// @return false if a chunk could not be received.
+bool receive_all(int socket,
+                 const std::vector<size_t> &lens,
+                 const ElementConsumer &consume = ElementConsumer());
+
+/// Stop-and-wait: send a chunk, wait for its ack. Works on REQ/REP.
+/// @return false if a chunk could not be sent or was not acked.
+bool send_all(int socket,
               const std::vector<void *> &data,
               const std::vector<size_t> &lens);
 
+/// Pipelined: up to window chunks are in flight before the sender waits
+/// for an ack. Needs sockets that are not in lockstep, i.e. NN_PAIR.
+bool send_all(int socket,
+              const std::vector<void *> &data,
+              const std::vector<size_t> &lens,
+              size_t window);
+
+/// Pipelined send of chunks produced on the fly: producing chunk k + 1
+/// overlaps the transfer of the chunks in flight. The chunk memory can be
+/// reused once produce() is called again, nanomsg has copied it by then.
+/// @return false if a chunk could not be sent or was not acked, the
+///         chunks after it are not sent.
+bool send_stream(int socket,
+                 size_t chunks,
+                 const ChunkProducer &produce,
+                 size_t window);
+
+/// Encode a ciphertext straight into a new nanomsg message, see MDL::wire.
+/// @param needed. The levels the receiver's computation needs, the
+///                ciphertext is mod-switched down to them before encoding.
+///                -1 keeps its level.
+/// @return the message, nn_sendmsg() or nn_freemsg() releases it.
+void *encode_message(const Ctxt &ctxt, size_t &len, long needed = -1);
+
+/// Decode a ciphertext in place from a received message.
+bool decode_message(Ctxt &ctxt, const void *msg, size_t len);
+
+/// Typed transfers: a message with the layout and the element lengths,
+/// then all the ciphertexts of the object in one scatter/gather transfer
+/// (send_all), encoded straight into the messages. Sender and receiver
+/// alternate like send_all/receive_all, so they work over REQ/REP.
+/// Defined for EncVector, MPEncVector and Paillier::Ctxt. The receiving
+/// object is constructed with the public key of the ciphertexts.
+/// @return the bytes of the ciphertexts, -1 on failure.
 template<class T>
 long receive(T &obj, int sock);
 
 template<class T>
 long send(const T &obj, int sock);
+
+template<> long send(const EncVector &obj, int sock);
+template<> long send(const MPEncVector &obj, int sock);
+template<> long send(const MPEncMatrix &obj, int sock);
+template<> long send(const Paillier::Ctxt &obj, int sock);
+template<> long send(const std::vector<EncVector> &objs, int sock);
+template<> long send(const std::vector<Paillier::Ctxt> &objs, int sock);
+
+template<> long receive(EncVector &obj, int sock);
+template<> long receive(MPEncVector &obj, int sock);
+template<> long receive(Paillier::Ctxt &obj, int sock);
+
+/// The containers are resized, their elements need the public key.
+long receive(MPEncMatrix &obj, const MPPubKey &pk, int sock);
+
+long receive(std::vector<EncVector> &objs, const FHEPubKey &pk, int sock);
+
+long receive(std::vector<Paillier::Ctxt> &objs,
+             const Paillier::PubKey &pk, int sock);
 #endif
 } // namespace net
 }; // namespace MDL
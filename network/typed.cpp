@@ -0,0 +1,312 @@
+#include "network.hpp"
+#include "algebra/EncVector.hpp"
+#include "multiprecision/MPEncVector.hpp"
+#include "multiprecision/MPEncMatrix.hpp"
+#include "multiprecision/MPPubKey.hpp"
+#include "paillier/Paillier.hpp"
+#include "utils/Parallel.hpp"
+#include <nanomsg/nn.h>
+#include <cstdint>
+#include <cstring>
+namespace MDL {
+namespace net {
+#ifdef USE_NETWORK
+namespace {
+/// A bound on the length of one received element.
+const int64_t MAX_ELEMENT_BYTES = int64_t(1) << 32;
+
+enum Kind {
+    ENC_VECTOR = 1,
+    ENC_VECTORS,
+    MP_ENC_VECTOR,
+    MP_ENC_MATRIX,
+    PAILLIER_CTXT,
+    PAILLIER_CTXTS
+};
+
+/// The encoded elements of an object, in nanomsg messages.
+struct Outgoing {
+    std::vector<long> layout;
+    std::vector<void *> data;
+    std::vector<size_t> lens;
+
+    ~Outgoing() {
+        for (auto msg : data)
+            if (msg != NULL) nn_freemsg(msg);
+    }
+
+    /// Encode the ciphertexts in parallel.
+    void add(const std::vector<const ::Ctxt *> &ctxts) {
+        size_t first = data.size();
+        data.resize(first + ctxts.size(), NULL);
+        lens.resize(first + ctxts.size(), 0);
+        parallel::parallel_for(parallel::PROTOCOL, ctxts.size(),
+                               [this, first, &ctxts](long i) {
+            data[first + i] = encode_message(*ctxts[i], lens[first + i]);
+        });
+    }
+
+    void add(const NTL::ZZ &value, size_t bytes) {
+        void *msg = nn_allocmsg(bytes, 0);
+        NTL::BytesFromZZ((unsigned char *)msg, value, bytes);
+        data.push_back(msg);
+        lens.push_back(bytes);
+    }
+};
+
+struct Incoming {
+    std::vector<long> layout;
+    std::vector<size_t> lens;
+};
+
+long total(const std::vector<size_t> &lens) {
+    long bytes = 0;
+    for (auto len : lens) bytes += len;
+    return bytes;
+}
+
+long transmit(int sock, Kind kind, const Outgoing &out) {
+    std::vector<int64_t> meta;
+    meta.push_back(kind);
+    meta.push_back(out.layout.size());
+    meta.insert(meta.end(), out.layout.begin(), out.layout.end());
+    meta.push_back(out.lens.size());
+    meta.insert(meta.end(), out.lens.begin(), out.lens.end());
+    if (nn_send(sock, meta.data(), meta.size() * sizeof(meta[0]), 0) < 0) {
+        printf("send error %s\n", nn_strerror(nn_errno()));
+        return -1;
+    }
+    if (nn_recv(sock, NULL, 0, 0) < 0) {
+        printf("ack error %s\n", nn_strerror(nn_errno()));
+        return -1;
+    }
+
+    if (!send_all(sock, out.data, out.lens)) return -1;
+    return total(out.lens);
+}
+
+/// Receive the layout message. On a kind mismatch the elements are
+/// drained so that the next transfer stays in step. A malformed layout
+/// message is rejected without draining, its lengths can not be trusted.
+bool expect(int sock, Kind kind, Incoming &in) {
+    char *buf;
+    int got = nn_recv(sock, &buf, NN_MSG, 0);
+    if (got < 0) {
+        printf("receive error %s\n", nn_strerror(nn_errno()));
+        return false;
+    }
+    std::vector<int64_t> meta(got / sizeof(int64_t));
+    std::memcpy(meta.data(), buf, meta.size() * sizeof(int64_t));
+    nn_freemsg(buf);
+    if (nn_send(sock, NULL, 0, 0) < 0) {
+        printf("ack error %s\n", nn_strerror(nn_errno()));
+        return false;
+    }
+
+    // kind, layout size, layout..., count, lens...
+    const int64_t words = meta.size();
+    int64_t layoutSize = words >= 3 ? meta[1] : -1;
+    int64_t count = layoutSize >= 0 && layoutSize <= words - 3 ?
+        meta[2 + layoutSize] : -1;
+    if (got % sizeof(int64_t) != 0 || count < 0 ||
+        count != words - 3 - layoutSize) {
+        printf("Warnning! malformed layout message of %d bytes\n", got);
+        return false;
+    }
+    in.layout.assign(meta.begin() + 2, meta.begin() + 2 + layoutSize);
+    for (int64_t i = 0; i < count; i++) {
+        int64_t len = meta[3 + layoutSize + i];
+        if (len < 0 || len > MAX_ELEMENT_BYTES) {
+            printf("Warnning! element of %ld bytes\n", (long)len);
+            return false;
+        }
+        in.lens.push_back(len);
+    }
+
+    if (meta[0] != kind) {
+        printf("Warnning! expected a message of kind %d, got %ld\n",
+               kind, (long)meta[0]);
+        receive_all(sock, in.lens);
+        return false;
+    }
+    return true;
+}
+
+/// Drain the elements of a layout the receiver can not take.
+void reject(int sock, const Incoming &in, const char *what) {
+    printf("Warnning! %s\n", what);
+    receive_all(sock, in.lens);
+}
+
+typedef std::function<bool(size_t, const void *, size_t)> Decoder;
+
+/// Receive the elements, decode(i, data, len) is called in order.
+long collect(int sock, const Incoming &in, const Decoder &decode) {
+    bool ok = true;
+    bool received = receive_all(sock, in.lens, [&ok, &decode](size_t i,
+                                                              const void *data,
+                                                              size_t len) {
+        if (!decode(i, data, len)) ok = false;
+    });
+    ok = ok && received;
+    return ok ? total(in.lens) : -1;
+}
+} // namespace
+
+template<>
+long send(const EncVector &obj, int sock) {
+    Outgoing out;
+    out.add({&obj});
+    return transmit(sock, ENC_VECTOR, out);
+}
+
+template<>
+long send(const std::vector<EncVector> &objs, int sock) {
+    Outgoing out;
+    std::vector<const ::Ctxt *> ctxts;
+    for (auto &obj : objs) ctxts.push_back(&obj);
+    out.layout.push_back(objs.size());
+    out.add(ctxts);
+    return transmit(sock, ENC_VECTORS, out);
+}
+
+template<>
+long send(const MPEncVector &obj, int sock) {
+    Outgoing out;
+    std::vector<const ::Ctxt *> ctxts;
+    for (size_t i = 0; i < obj.partsNum(); i++) ctxts.push_back(&obj.get(i));
+    out.layout = {obj.getLength(), (long)obj.partsNum()};
+    out.add(ctxts);
+    return transmit(sock, MP_ENC_VECTOR, out);
+}
+
+template<>
+long send(const MPEncMatrix &obj, int sock) {
+    Outgoing out;
+    std::vector<const ::Ctxt *> ctxts;
+    long parts = obj.rowsNum() > 0 ? obj.get(0).partsNum() : 0;
+    for (size_t r = 0; r < obj.rowsNum(); r++)
+        for (long i = 0; i < parts; i++) ctxts.push_back(&obj.get(r).get(i));
+    out.layout = {obj.getRows(), obj.getColumns(), (long)obj.getPacking(),
+                  (long)obj.rowsNum(), parts};
+    for (size_t r = 0; r < obj.rowsNum(); r++)
+        out.layout.push_back(obj.get(r).getLength());
+    out.layout.insert(out.layout.end(), obj.getOffsets().begin(),
+                      obj.getOffsets().end());
+    out.add(ctxts);
+    return transmit(sock, MP_ENC_MATRIX, out);
+}
+
+template<>
+long send(const Paillier::Ctxt &obj, int sock) {
+    Outgoing out;
+    size_t bytes = NTL::NumBytes(obj.GetPk().GetN2());
+    out.layout.push_back(bytes);
+    out.add(obj.GetValue(), bytes);
+    return transmit(sock, PAILLIER_CTXT, out);
+}
+
+template<>
+long send(const std::vector<Paillier::Ctxt> &objs, int sock) {
+    Outgoing out;
+    size_t bytes = objs.empty() ? 0 : NTL::NumBytes(objs[0].GetPk().GetN2());
+    out.layout = {(long)objs.size(), (long)bytes};
+    for (auto &obj : objs) out.add(obj.GetValue(), bytes);
+    return transmit(sock, PAILLIER_CTXTS, out);
+}
+
+template<>
+long receive(EncVector &obj, int sock) {
+    Incoming in;
+    if (!expect(sock, ENC_VECTOR, in)) return -1;
+    if (in.lens.size() != 1) {
+        reject(sock, in, "one EncVector expected");
+        return -1;
+    }
+    return collect(sock, in, [&obj](size_t, const void *data, size_t len) {
+        return decode_message(obj, data, len);
+    });
+}
+
+long receive(std::vector<EncVector> &objs, const FHEPubKey &pk, int sock) {
+    Incoming in;
+    if (!expect(sock, ENC_VECTORS, in)) return -1;
+    objs.assign(in.lens.size(), EncVector(pk));
+    return collect(sock, in, [&objs](size_t i, const void *data, size_t len) {
+        return decode_message(objs[i], data, len);
+    });
+}
+
+template<>
+long receive(MPEncVector &obj, int sock) {
+    Incoming in;
+    if (!expect(sock, MP_ENC_VECTOR, in)) return -1;
+    if (in.layout.size() != 2 || in.layout[1] != (long)obj.partsNum() ||
+        in.lens.size() != obj.partsNum()) {
+        reject(sock, in, "MPEncVector with another number of parts");
+        return -1;
+    }
+    obj.setLength(in.layout[0]);
+    return collect(sock, in, [&obj](size_t i, const void *data, size_t len) {
+        return decode_message(obj.get(i), data, len);
+    });
+}
+
+long receive(MPEncMatrix &obj, const MPPubKey &pk, int sock) {
+    Incoming in;
+    if (!expect(sock, MP_ENC_MATRIX, in)) return -1;
+    long num = in.layout.size() >= 5 ? in.layout[3] : -1;
+    long parts = in.layout.size() >= 5 ? in.layout[4] : -1;
+    // every row has one ciphertext per part.
+    if (num < 0 || parts != (long)pk.keyNum() ||
+        (long)in.layout.size() < 5 + num ||
+        (long)in.lens.size() != num * parts) {
+        reject(sock, in, "MPEncMatrix with another number of parts");
+        return -1;
+    }
+
+    std::vector<MPEncVector> rows(num, pk);
+    for (long r = 0; r < num; r++) rows[r].setLength(in.layout[5 + r]);
+    long bytes = collect(sock, in, [&rows, parts](size_t i, const void *data,
+                                                  size_t len) {
+        return decode_message(rows[i / parts].get(i % parts), data, len);
+    });
+    obj = MPEncMatrix(rows);
+    obj.setLayout(in.layout[0], in.layout[1],
+                  static_cast<MatrixPacking>(in.layout[2]),
+                  std::vector<long>(in.layout.begin() + 5 + num,
+                                    in.layout.end()));
+    return bytes;
+}
+
+template<>
+long receive(Paillier::Ctxt &obj, int sock) {
+    Incoming in;
+    if (!expect(sock, PAILLIER_CTXT, in)) return -1;
+    if (in.lens.size() != 1) {
+        reject(sock, in, "one Paillier::Ctxt expected");
+        return -1;
+    }
+    return collect(sock, in, [&obj](size_t, const void *data, size_t len) {
+        obj.SetCtxt(NTL::ZZFromBytes((const unsigned char *)data, len));
+        return true;
+    });
+}
+
+long receive(std::vector<Paillier::Ctxt> &objs,
+             const Paillier::PubKey &pk, int sock) {
+    Incoming in;
+    if (!expect(sock, PAILLIER_CTXTS, in)) return -1;
+    objs.clear();
+    objs.reserve(in.lens.size());
+    return collect(sock, in, [&objs, &pk](size_t, const void *data,
+                                          size_t len) {
+        Paillier::Ctxt ctxt(pk);
+        ctxt.SetCtxt(NTL::ZZFromBytes((const unsigned char *)data, len));
+        objs.push_back(std::move(ctxt));
+        return true;
+    });
+}
+#endif
+} // namespace net
+} // namespace MDL
@@ -0,0 +1,89 @@
+#include "Batch.hpp"
+#include "utils/Parallel.hpp"
+#include <algorithm>
+#include <cstdio>
+namespace MDL {
+namespace Paillier {
+static void forEachRecord(long n, const std::function<void(long)> &body)
+{
+    MDL::parallel::parallel_for(MDL::parallel::PAILLIER, n, body);
+}
+
+void EncryptBatch(std::vector<Ctxt> &ctxts,
+                  const std::vector<NTL::ZZ> &plains,
+                  const PubKey &pk)
+{
+    ctxts.assign(plains.size(), Ctxt(pk));
+    forEachRecord(plains.size(), [&](long i) {
+        pk.Encrypt(ctxts[i], plains[i]);
+    });
+}
+
+void PackBatch(std::vector<Ctxt> &ctxts,
+               const std::vector<MDL::Vector<long>> &rows,
+               int bits,
+               const PubKey &pk)
+{
+    ctxts.assign(rows.size(), Ctxt(pk));
+    forEachRecord(rows.size(), [&](long i) {
+        pk.Pack(ctxts[i], rows[i], bits);
+    });
+}
+
+void DecryptBatch(std::vector<NTL::ZZ> &plains,
+                  const std::vector<Ctxt> &ctxts,
+                  const SecKey &sk)
+{
+    plains.resize(ctxts.size());
+    forEachRecord(ctxts.size(), [&](long i) {
+        sk.Decrypt(plains[i], ctxts[i]);
+    });
+}
+
+void UnpackBatch(std::vector<std::vector<NTL::ZZ>> &slots,
+                 const std::vector<Ctxt> &ctxts,
+                 int bits,
+                 const SecKey &sk)
+{
+    slots.resize(ctxts.size());
+    forEachRecord(ctxts.size(), [&](long i) {
+        sk.Unpack(slots[i], ctxts[i], bits);
+    });
+}
+
+bool Sum(Ctxt &sum, const std::vector<Ctxt> &ctxts)
+{
+    if (ctxts.empty()) {
+        printf("Warnning! Paillier Sum of no ciphertexts!\n");
+        return false;
+    }
+
+    const long n = ctxts.size();
+    const long chunks = std::min(n, MDL::parallel::threads(MDL::parallel::PAILLIER));
+    const long chunk = (n + chunks - 1) / chunks;
+    std::vector<Ctxt> parts(chunks, ctxts[0]);
+    for (long c = 1; c < chunks; c++)
+        parts[c] = ctxts[std::min(n - 1, c * chunk)];
+
+    forEachRecord(chunks, [&](long c) {
+        const long end = std::min(n, (c + 1) * chunk);
+        for (long i = c * chunk + 1; i < end; i++)
+            parts[c] += ctxts[i];
+    });
+
+    // the last chunks may be empty when chunk * chunks > n.
+    const long used = (n + chunk - 1) / chunk;
+    for (long stride = 1; stride < used; stride <<= 1) {
+        const long pairs = (used + 2 * stride - 1) / (2 * stride);
+        forEachRecord(pairs, [&](long k) {
+            const long i = 2 * stride * k;
+            if (i + stride < used)
+                parts[i] += parts[i + stride];
+        });
+    }
+
+    sum = std::move(parts[0]);
+    return true;
+}
+} // namespace Paillier
+} // namespace MDL
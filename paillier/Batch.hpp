@@ -0,0 +1,41 @@
+#ifndef PAILLIER_BATCH_HPP
+#define PAILLIER_BATCH_HPP
+#include "Paillier.hpp"
+#include "algebra/Vector.hpp"
+#include <NTL/ZZ.h>
+#include <vector>
+/// Whole-table Paillier operations. The records are processed in parallel
+/// on the shared ThreadPool with the threads of the PAILLIER subsystem,
+/// see utils/Parallel.hpp.
+namespace MDL {
+namespace Paillier {
+/// ctxts[i] = Enc(plains[i])
+void EncryptBatch(std::vector<Ctxt> &ctxts,
+                  const std::vector<NTL::ZZ> &plains,
+                  const PubKey &pk);
+
+/// ctxts[i] = Pack(rows[i], bits)
+void PackBatch(std::vector<Ctxt> &ctxts,
+               const std::vector<MDL::Vector<long>> &rows,
+               int bits,
+               const PubKey &pk);
+
+/// plains[i] = Dec(ctxts[i])
+void DecryptBatch(std::vector<NTL::ZZ> &plains,
+                  const std::vector<Ctxt> &ctxts,
+                  const SecKey &sk);
+
+/// slots[i] = Unpack(ctxts[i], bits)
+void UnpackBatch(std::vector<std::vector<NTL::ZZ>> &slots,
+                 const std::vector<Ctxt> &ctxts,
+                 int bits,
+                 const SecKey &sk);
+
+/// sum = ctxts[0] + ctxts[1] + ... as a parallel tree reduction: every
+/// thread adds up a chunk of the ciphertexts, then the partial sums are
+/// added pairwise.
+/// @return false if ctxts is empty.
+bool Sum(Ctxt &sum, const std::vector<Ctxt> &ctxts);
+} // namespace Paillier
+} // namespace MDL
+#endif // paillier/Batch.hpp
@@ -0,0 +1,212 @@
+#include "Packing.hpp"
+#include "Batch.hpp"
+#include "algebra/CRT.hpp"
+#include <algorithm>
+#include <cassert>
+#include <climits>
+#include <cstdio>
+namespace MDL {
+namespace Paillier {
+// bound / maxAbs, at most LONG_MAX.
+static long additions(const NTL::ZZ &bound, const NTL::ZZ &maxAbs)
+{
+    NTL::ZZ q = bound / maxAbs;
+    return NTL::NumBits(q) < NTL::NumBits(LONG_MAX) ? NTL::to_long(q) : LONG_MAX;
+}
+
+PackingLayout::PackingLayout(const PubKey &pk, long valueBits, long records,
+                             PackingMode mode)
+    : pk(&pk), mode(mode), valueBits(valueBits)
+{
+    assert(valueBits > 0);
+    records = std::max(1L, records);
+    const NTL::ZZ maxAbs = (NTL::to_ZZ(1) << valueBits) - 1;
+    // a sign bit, then one more bit at a time until records sums fit.
+    const long available = NTL::NumBits(pk.GetN()) - 2;
+    for (long width = valueBits + 1; width <= available; width++) {
+        NTL::ZZ bound;
+        long count, limit = LONG_MAX;
+        if (mode == SHIFT_PACKING) {
+            bound = (NTL::to_ZZ(1) << (width - 1)) - 1;
+            count = available / width;
+        } else {
+            // only the moduli, the basis of the chosen width is built by
+            // the first Pack.
+            const auto moduli = pk.GetPrimes(width);
+            if (moduli.empty()) break;
+            NTL::ZZ product(1);
+            for (const auto &m : moduli) product *= m;
+            // Unpack centers the residues.
+            bound = (*std::min_element(moduli.begin(), moduli.end()) - 1) / 2;
+            count = moduli.size();
+            // the packed values are in [0, product), their sum must stay
+            // below n / 2 as well.
+            limit = additions((pk.GetN() - 1) / 2, product);
+        }
+
+        long absorbs = std::min(limit, additions(bound, maxAbs));
+        if (absorbs >= records) {
+            slotBits = width;
+            slots = count;
+            capacity = absorbs;
+            return;
+        }
+    }
+    printf("Warnning! No Paillier slot fits %ld values of %ld bits!\n",
+           records, valueBits);
+}
+
+PackingLayout PackingLayout::Best(const PubKey &pk, long valueBits, long records)
+{
+    PackingLayout crt(pk, valueBits, records, CRT_PACKING);
+    PackingLayout shift(pk, valueBits, records, SHIFT_PACKING);
+    return crt.slots > shift.slots ? crt : shift;
+}
+
+long PackingLayout::CtxtsFor(long values) const
+{
+    if (!Valid()) return 0;
+    return (values + slots - 1) / slots;
+}
+
+bool PackingLayout::Pack(std::vector<Ctxt> &ctxts,
+                         const std::vector<long> &record) const
+{
+    if (!Valid()) return false;
+    const long bound = valueBits < NTL::NumBits(LONG_MAX) ? (1L << valueBits) : LONG_MAX;
+    for (long v : record) {
+        // not -v >= bound, -LONG_MIN overflows.
+        if (v >= bound || v <= -bound) {
+            printf("Warnning! %ld does not fit a %ld-bit slot!\n", v, valueBits);
+            return false;
+        }
+    }
+
+    const long num = CtxtsFor(record.size());
+    ctxts.assign(num, Ctxt(*pk));
+    for (long c = 0; c < num; c++) {
+        auto begin = record.begin() + c * slots;
+        auto end = record.begin() + std::min<long>(record.size(), (c + 1) * slots);
+        if (mode == CRT_PACKING) {
+            pk->Pack(ctxts[c], std::vector<long>(begin, end), slotBits);
+            continue;
+        }
+
+        NTL::ZZ plain(0);
+        for (auto it = end; it != begin; ) {
+            plain <<= slotBits;
+            plain += *--it;
+        }
+        pk->Encrypt(ctxts[c], plain);
+    }
+    return true;
+}
+
+void PackingLayout::Unpack(std::vector<NTL::ZZ> &record,
+                           const std::vector<Ctxt> &ctxts,
+                           long values,
+                           const SecKey &sk) const
+{
+    record.resize(values);
+    const NTL::ZZ &n = pk->GetN();
+    const NTL::ZZ modulus = NTL::to_ZZ(1) << slotBits;
+    const NTL::ZZ half = modulus >> 1;
+    std::vector<NTL::ZZ> slotValues;
+    for (long c = 0; c < static_cast<long>(ctxts.size()); c++) {
+        const long begin = c * slots;
+        const long end = std::min(values, begin + slots);
+        if (mode == CRT_PACKING) {
+            sk.Unpack(slotValues, ctxts[c], slotBits);
+            for (long i = begin; i < end; i++)
+                record[i] = slotValues[i - begin];
+            continue;
+        }
+
+        NTL::ZZ plain, slot;
+        sk.Decrypt(plain, ctxts[c]);
+        if ((plain << 1) >= n)
+            plain -= n;
+        // the lowest slot first, a negative slot borrows from the next.
+        for (long i = begin; i < end; i++) {
+            NTL::rem(slot, plain, modulus);
+            if (slot >= half)
+                slot -= modulus;
+            plain -= slot;
+            plain >>= slotBits;
+            record[i] = slot;
+        }
+    }
+}
+
+PackedSum::PackedSum(const PackingLayout &layout, long values)
+    : layout(layout), values(values) {}
+
+bool PackedSum::Add(const std::vector<Ctxt> &record)
+{
+    if (static_cast<long>(record.size()) != layout.CtxtsFor(values)) {
+        printf("Warnning! PackedSum Add of a record of another layout!\n");
+        return false;
+    }
+
+    if (groups.empty() || inLast >= layout.Capacity()) {
+        groups.push_back(record);
+        inLast = 1;
+    } else {
+        auto &sums = groups.back();
+        for (size_t c = 0; c < sums.size(); c++)
+            sums[c] += record[c];
+        inLast += 1;
+    }
+    records += 1;
+    return true;
+}
+
+bool PackedSum::Add(const std::vector<std::vector<Ctxt>> &batch)
+{
+    const long num = layout.CtxtsFor(values);
+    for (auto &record : batch) {
+        if (static_cast<long>(record.size()) != num) {
+            printf("Warnning! PackedSum Add of a record of another layout!\n");
+            return false;
+        }
+    }
+
+    size_t next = 0;
+    while (next < batch.size()) {
+        // fill the last set of sums up to the capacity first.
+        if (groups.empty() || inLast >= layout.Capacity()) {
+            groups.push_back(batch[next++]);
+            inLast = 1;
+            records += 1;
+            continue;
+        }
+
+        const size_t take = std::min<size_t>(batch.size() - next,
+                                             layout.Capacity() - inLast);
+        auto &sums = groups.back();
+        for (long c = 0; c < num; c++) {
+            std::vector<Ctxt> column(1, sums[c]);
+            column.reserve(take + 1);
+            for (size_t r = next; r < next + take; r++)
+                column.push_back(batch[r][c]);
+            Sum(sums[c], column);
+        }
+        inLast += take;
+        records += take;
+        next += take;
+    }
+    return true;
+}
+
+void PackedSum::Decrypt(std::vector<NTL::ZZ> &sums, const SecKey &sk) const
+{
+    sums.assign(values, NTL::to_ZZ(0));
+    std::vector<NTL::ZZ> record;
+    for (auto &group : groups) {
+        layout.Unpack(record, group, values, sk);
+        for (long i = 0; i < values; i++)
+            sums[i] += record[i];
+    }
+}
+} // namespace Paillier
+} // namespace MDL
@@ -0,0 +1,87 @@
+#ifndef PAILLIER_PACKING_HPP
+#define PAILLIER_PACKING_HPP
+#include "Paillier.hpp"
+#include <NTL/ZZ.h>
+#include <vector>
+namespace MDL {
+namespace Paillier {
+enum PackingMode {
+    /// one value per group of GetPrimes(bits), see PubKey::Pack.
+    CRT_PACKING,
+    /// value i at bits [i * width, (i + 1) * width) of the plaintext.
+    SHIFT_PACKING
+};
+
+/// @brief The slot layout of packed ciphertexts that will be added up.
+/// The slot width is chosen such that the sum of records ciphertexts,
+/// each slot holding a value |v| < 2^valueBits, can not overflow.
+class PackingLayout {
+public:
+    PackingLayout(const PubKey &pk, long valueBits, long records,
+                  PackingMode mode);
+
+    /// The layout of the mode with more slots per ciphertext.
+    static PackingLayout Best(const PubKey &pk, long valueBits, long records);
+
+    /// @return false if no slot of the key is wide enough.
+    bool Valid() const { return slots > 0; }
+
+    PackingMode Mode() const { return mode; }
+
+    long Slots() const { return slots; }
+
+    long SlotBits() const { return slotBits; }
+
+    long ValueBits() const { return valueBits; }
+
+    /// The number of packed ciphertexts whose sum is guaranteed to fit.
+    long Capacity() const { return capacity; }
+
+    /// The number of ciphertexts of a record with values values.
+    long CtxtsFor(long values) const;
+
+    /// Split the record over CtxtsFor(record.size()) ciphertexts.
+    /// @return false if a value is out of range.
+    bool Pack(std::vector<Ctxt> &ctxts, const std::vector<long> &record) const;
+
+    /// The first values slots of the ciphertexts.
+    void Unpack(std::vector<NTL::ZZ> &record, const std::vector<Ctxt> &ctxts,
+                long values, const SecKey &sk) const;
+private:
+    const PubKey *pk;
+    PackingMode mode;
+    long valueBits, slotBits = 0, slots = 0, capacity = 0;
+};
+
+/// @brief The sum of packed records. A record that would overflow the
+/// current sums starts a new set of sums, which are combined after the
+/// decryption.
+class PackedSum {
+public:
+    /// @param values. The number of values of each record.
+    PackedSum(const PackingLayout &layout, long values);
+
+    /// @return false if the record does not have the layout's ciphertexts.
+    bool Add(const std::vector<Ctxt> &record);
+
+    /// Add all the records, every set of sums as a parallel tree reduction.
+    bool Add(const std::vector<std::vector<Ctxt>> &batch);
+
+    long Records() const { return records; }
+
+    /// The sets of sums, each of layout.CtxtsFor(values) ciphertexts.
+    const std::vector<std::vector<Ctxt>>& Groups() const { return groups; }
+
+    /// The sums of every value over all the records.
+    void Decrypt(std::vector<NTL::ZZ> &sums, const SecKey &sk) const;
+private:
+    const PackingLayout layout;
+    const long values;
+    long records = 0;
+    // records added into groups.back().
+    long inLast = 0;
+    std::vector<std::vector<Ctxt>> groups;
+};
+} // namespace Paillier
+} // namespace MDL
+#endif // paillier/Packing.hpp
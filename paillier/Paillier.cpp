@@ -1,160 +1,140 @@
 #include "Paillier.hpp"
+#include "RandomnessPool.hpp"
 #include "algebra/CRT.hpp"
+#include <atomic>
 #include <cassert>
+#include <map>
+#include <mutex>
 #include "algorithm"
 namespace MDL {
 namespace Paillier {
 
-class Ctxt::CtxtImp {
-public:
-    CtxtImp(const PubKey &pk) : pk(pk) {}
-    CtxtImp(const CtxtImp &oth) : pk(oth.pk) {
-        this->value = oth.value;
-    }
-    CtxtImp& operator=(const CtxtImp &oth) = delete;
-
-    void SetCtxt(const NTL::ZZ &v) {
-        this->value = v;
-    }
-
-    void SetCtxt(const long v) {
-        this->value = NTL::to_ZZ(v);
-    }
-
-    const NTL::ZZ& GetValue() const {
-        return value;
-    }
-
-    const PubKey& GetPk() const {
-        return pk;
-    }
-
-    CtxtImp& negate() {
-        NTL::InvMod(value, value, pk.GetN2());
-        return *this;
-    }
-
-    CtxtImp& operator+=(const CtxtImp &oth) {
-        assert(pk == oth.pk);
-        NTL::MulMod(value, value, oth.value, pk.GetN2());
-        return *this;
-    }
-
-    CtxtImp& operator+=(long v) {
-        return operator+=(NTL::to_ZZ(v));
-    }
-
-    CtxtImp& operator+=(const NTL::ZZ &v) {
-        Ctxt c(pk);
-        pk.Encrypt(c, v);
-        return (*this += *c.imp);
-    }
-
-    CtxtImp& operator-=(const CtxtImp &oth) {
-        auto tmp(oth);
-        tmp *= -1;
-        return (*this += tmp);
-    }
-
-    CtxtImp& operator-=(long v) {
-        return operator-=(NTL::to_ZZ(v));
-    }
+Ctxt::Ctxt(const PubKey &pk) : pk(&pk) {}
 
-    CtxtImp& operator-=(const NTL::ZZ &v) {
-        Ctxt c(pk);
-        pk.Encrypt(c, -v);
-        return (*this += *c.imp);
-    }
-
-    CtxtImp& operator*=(long v) {
-        return operator*=(NTL::to_ZZ(v));
-    }
-
-    CtxtImp& operator*=(const NTL::ZZ &v) {
-        auto vv(v);
-        if (vv < 0) {
-            NTL::InvMod(value, value, pk.GetN2());
-            vv *= -1;
-        }
-        NTL::PowerMod(value, value, vv, pk.GetN2());
-        return *this;
-    }
-private:
-    NTL::ZZ value;
-    const PubKey &pk;
-};
-
-Ctxt::Ctxt(const PubKey &pk) {
-    imp = std::make_shared<CtxtImp>(pk);
+Ctxt::Ctxt(Ctxt &&oth) noexcept : pk(oth.pk) {
+    NTL::swap(value, oth.value);
 }
 
-Ctxt::Ctxt(const Ctxt &oth) {
-    imp = std::make_shared<CtxtImp>(*oth.imp);
+Ctxt& Ctxt::operator=(Ctxt &&oth) noexcept {
+    NTL::swap(value, oth.value);
+    pk = oth.pk;
+    return *this;
 }
 
 const NTL::ZZ& Ctxt::GetValue() const {
-    return imp->GetValue();
+    return value;
 }
 
 void Ctxt::SetCtxt(const NTL::ZZ &number) {
-    imp->SetCtxt(number);
+    value = number;
 }
 
 void Ctxt::SetCtxt(const long number) {
-    imp->SetCtxt(number);
+    value = NTL::to_ZZ(number);
 }
 
 Ctxt& Ctxt::negate() {
-    imp->negate();
+    NTL::InvMod(value, value, pk->GetN2());
     return *this;
 }
 
 Ctxt& Ctxt::operator+=(const Ctxt &oth) {
-    imp->operator+=(*oth.imp);
+    assert(*pk == *oth.pk);
+    NTL::MulMod(value, value, oth.value, pk->GetN2());
     return *this;
 }
 
 Ctxt& Ctxt::operator+=(const long v) {
-    imp->operator+=(v);
-    return *this;
+    return operator+=(NTL::to_ZZ(v));
 }
 
 Ctxt& Ctxt::operator+=(const NTL::ZZ &v) {
-    imp->operator+=(v);
-    return *this;
+    Ctxt c(*pk);
+    pk->Encrypt(c, v);
+    return operator+=(c);
 }
 
 Ctxt& Ctxt::operator-=(const Ctxt &oth) {
-    imp->operator-=(*oth.imp);
-    return *this;
+    Ctxt tmp(oth);
+    tmp.negate();
+    return operator+=(tmp);
 }
 
 Ctxt& Ctxt::operator-=(const long v) {
-    imp->operator-=(v);
-    return *this;
+    return operator-=(NTL::to_ZZ(v));
 }
 
 Ctxt& Ctxt::operator-=(const NTL::ZZ &v) {
-    imp->operator-=(v);
-    return *this;
+    Ctxt c(*pk);
+    pk->Encrypt(c, -v);
+    return operator+=(c);
 }
+
 Ctxt& Ctxt::operator*=(const long v) {
-    imp->operator*=(v);
-    return *this;
+    return operator*=(NTL::to_ZZ(v));
 }
 
 Ctxt& Ctxt::operator*=(const NTL::ZZ &v) {
-    imp->operator*=(v);
+    if (v < 0) {
+        NTL::InvMod(value, value, pk->GetN2());
+        NTL::PowerMod(value, value, -v, pk->GetN2());
+    } else {
+        NTL::PowerMod(value, value, v, pk->GetN2());
+    }
     return *this;
 }
 
 const PubKey& Ctxt::GetPk() const {
-    return imp->GetPk();
+    return *pk;
 }
 
+/// base^e mod m for a fixed base from a comb table:
+/// table[i][d] = base^(d * 2^(window * i)).
+class FixedBase {
+public:
+    FixedBase(const NTL::ZZ &base, const NTL::ZZ &mod,
+              long bits, long window)
+        : mod(mod), bits(bits), window(window) {
+        assert(bits > 0 && window > 0 && window < 16);
+        const long digits = 1L << window;
+        NTL::ZZ b(base);
+        table.resize((bits + window - 1) / window);
+        for (auto &row : table) {
+            row.resize(digits);
+            row[0] = 1;
+            for (long d = 1; d < digits; d++)
+                NTL::MulMod(row[d], row[d - 1], b, mod);
+            // b^(2^window) for the next digit.
+            NTL::MulMod(b, row[digits - 1], b, mod);
+        }
+    }
+
+    void Power(NTL::ZZ &res, const NTL::ZZ &e) const {
+        res = 1;
+        for (size_t i = 0; i < table.size(); i++) {
+            long d = 0;
+            for (long j = 0; j < window; j++)
+                d |= NTL::bit(e, i * window + j) << j;
+            if (d != 0)
+                NTL::MulMod(res, res, table[i][d], mod);
+        }
+    }
+
+    /// base^e for a fresh random e of bits bits.
+    void RandomPower(NTL::ZZ &res) const {
+        NTL::ZZ e;
+        NTL::RandomBits(e, bits);
+        Power(res, e);
+    }
+private:
+    NTL::ZZ mod;
+    long bits, window;
+    std::vector<std::vector<NTL::ZZ>> table;
+};
+
 class PubKey::PubKeyImp {
 public:
-    PubKeyImp(const NTL::ZZ &n) : n(n), g(n + 1) {
+    PubKeyImp(const NTL::ZZ &n) : id(nextId++), n(n), g(n + 1) {
         assert(n > 0);
         n2 = n * n;
         long target_bits_len = NTL::NumBits(n) >> 1;
@@ -173,13 +153,15 @@ public:
         }
     }
 
-    PubKeyImp(const PubKeyImp &oth) : n(oth.n), g(oth.g), n2(oth.n2), primes(oth.primes) { }
+    PubKeyImp(const PubKeyImp &oth) : id(oth.id), n(oth.n), g(oth.g), n2(oth.n2), primes(oth.primes),
+                                      fixedBase(oth.fixedBase), pool(oth.pool) { }
 
     bool operator==(const PubKey &oth) const {
         return *this == *oth.imp;
     }
 
     bool operator==(const PubKey::PubKeyImp &oth) const {
+        if (oth.id == id) return true;
         if (oth.primes.size() != primes.size()) return false;
         if (oth.n != n) return false;
         for (size_t i = 0; i < primes.size(); i++) {
@@ -195,35 +177,94 @@ public:
 
     void Encrypt(Ctxt &ctxt, const NTL::ZZ &plain) const {
         assert(*this == ctxt.GetPk());
-        auto bits = NTL::NumBits(n);
         NTL::ZZ r, res;
-        NTL::RandomBits(r, bits);
-        NTL::PowerMod(r, r, n, n2);
-        NTL::PowerMod(res, g, plain, n2);
-        NTL::MulMod(res, r, n2);
+        Randomness(r);
+        // g^m = (1 + n)^m = 1 + m * n mod n^2, for negative m too.
+        NTL::rem(res, plain, n);
+        res *= n;
+        res += 1;
+        NTL::MulMod(res, res, r, n2);
         ctxt.SetCtxt(res);
     }
 
+    /// r^n mod n^2 for a random r, from the pool if there is one.
+    void Randomness(NTL::ZZ &r) const {
+        if (pool)
+            pool->Take(r);
+        else
+            Randomness(r, n, n2, fixedBase.get());
+    }
+
+    static void Randomness(NTL::ZZ &r, const NTL::ZZ &n, const NTL::ZZ &n2,
+                           const FixedBase *fixedBase) {
+        if (fixedBase) {
+            fixedBase->RandomPower(r);
+            return;
+        }
+        NTL::RandomBits(r, NTL::NumBits(n));
+        NTL::PowerMod(r, r, n, n2);
+    }
+
+    void EnableFixedBase(long exponentBits, long window) {
+        if (exponentBits <= 0)
+            exponentBits = NTL::NumBits(n) >> 1;
+        NTL::ZZ h;
+        NTL::RandomBits(h, NTL::NumBits(n));
+        NTL::PowerMod(h, h, n, n2);
+        fixedBase = std::make_shared<const FixedBase>(h, n2, exponentBits, window);
+        // the pooled values should come from the table as well.
+        if (pool)
+            EnableRandomnessPool(pool->Capacity(), pool->Workers());
+    }
+
+    void EnableRandomnessPool(long capacity, long workers) {
+        // the workers own copies, the pool may outlive this key.
+        NTL::ZZ n(this->n), n2(this->n2);
+        auto table = fixedBase;
+        pool = nullptr;
+        pool = std::make_shared<RandomnessPool>([n, n2, table](NTL::ZZ &r) {
+            Randomness(r, n, n2, table.get());
+        }, capacity, workers);
+    }
+
+    void DisableRandomnessPool() {
+        pool = nullptr;
+    }
+
+    std::shared_ptr<RandomnessPool> GetRandomnessPool() const {
+        return pool;
+    }
+
     void Pack(Ctxt &ctxt, long m, int bits) const {
-		auto tmp_primes = GetPrimes(bits);
-        std::vector<long> mm(tmp_primes.size(), m);
-        auto crt = MDL::CRT(mm, tmp_primes);
+        const auto &basis = GetBasis(bits);
+        std::vector<long> mm(basis.size(), m);
+        NTL::ZZ crt;
+        basis.reconstruct(crt, mm);
         Encrypt(ctxt, crt);
     }
 
     void Pack(Ctxt &ctxt, const std::vector<long> &slots, int bits) const {
-        auto tmp_primes = GetPrimes(bits);
-        assert(slots.size() <= tmp_primes.size());
-        auto crt = MDL::CRT(slots, tmp_primes);
+        const auto &basis = GetBasis(bits);
+        assert(slots.size() <= basis.size());
+        NTL::ZZ crt;
+        basis.reconstruct(crt, slots);
         Encrypt(ctxt, crt);
     }
 
+    const CRTBasis& GetBasis(long bits) const {
+        std::lock_guard<std::mutex> lock(basesMutex);
+        auto &basis = bases[bits];
+        if (!basis)
+            basis = std::make_shared<const CRTBasis>(GetPrimes(bits));
+        return *basis;
+    }
+
     const NTL::ZZ& GetN() const {
         return n;
     }
 
     const NTL::ZZ& GetG() const {
-        return n;
+        return g;
     }
 
     const NTL::ZZ& GetN2() const {
@@ -274,10 +315,20 @@ public:
     }
 
 private:
+    static std::atomic<long> nextId;
+    // shared by the copies of a key.
+    const long id;
     NTL::ZZ n, g, n2;
     PrimeSet primes;
+    std::shared_ptr<const FixedBase> fixedBase;
+    std::shared_ptr<RandomnessPool> pool;
+    // built on first use, copies of the key build their own.
+    mutable std::map<long, std::shared_ptr<const CRTBasis>> bases;
+    mutable std::mutex basesMutex;
 };
 
+std::atomic<long> PubKey::PubKeyImp::nextId(0);
+
 PubKey::PubKey(const NTL::ZZ &n) {
     imp = std::make_shared<PubKeyImp>(n);
 }
@@ -286,7 +337,7 @@ PubKey::PubKey(const PubKey &oth) {
     imp = std::make_shared<PubKeyImp>(*oth.imp);
 }
 bool PubKey::operator==(const PubKey &oth) const {
-    return *imp == *oth.imp;
+    return imp == oth.imp || *imp == *oth.imp;
 }
 
 void PubKey::Encrypt(Ctxt &ctxt, const NTL::ZZ &plain) const {
@@ -325,6 +376,10 @@ PrimeSet PubKey::GetPrimes(long bits) const {
     return imp->GetPrimes(bits);
 }
 
+const CRTBasis& PubKey::GetBasis(long bits) const {
+    return imp->GetBasis(bits);
+}
+
 long PubKey::bits_per_prime() const {
    return imp->bits_per_prime();
 }
@@ -333,22 +388,42 @@ long PubKey::bits_all_prime() const {
     return imp->bits_all_prime();
 }
 
+void PubKey::EnableFixedBase(long exponentBits, long window) {
+    imp->EnableFixedBase(exponentBits, window);
+}
+
+void PubKey::EnableRandomnessPool(long capacity, long workers) {
+    imp->EnableRandomnessPool(capacity, workers);
+}
+
+void PubKey::DisableRandomnessPool() {
+    imp->DisableRandomnessPool();
+}
+
+std::shared_ptr<RandomnessPool> PubKey::GetRandomnessPool() const {
+    return imp->GetRandomnessPool();
+}
+
 class SecKey::SecKeyImp {
 public:
-    SecKeyImp(const NTL::ZZ p, const NTL::ZZ &q, const PubKey &pk) : pk(pk) {
+    SecKeyImp(const NTL::ZZ p, const NTL::ZZ &q, const PubKey &pk)
+        : p(p), q(q), pk(pk) {
         assert(p * q == pk.GetN());
-        auto p_1 = p - 1;
-        auto q_1 = q - 1;
-        // l = lcm(p-1, q-1)
-        l = (p_1 * q_1) / NTL::GCD(p_1, q_1);
-        // il = l^-1 % n
-        NTL::InvMod(il, l, pk.GetN());
+        assert(p != q);
+        p2 = p * p;
+        q2 = q * q;
+        hp = H(p, p2);
+        hq = H(q, q2);
+        // q^-1 mod p to combine the two halves.
+        NTL::InvMod(qInv, q % p, p);
     }
 
-    SecKeyImp(const SecKeyImp &oth) : l(oth.l), il(oth.il), pk(oth.pk) { }
+    SecKeyImp(const SecKeyImp &oth) : p(oth.p), q(oth.q), p2(oth.p2), q2(oth.q2),
+                                      hp(oth.hp), hq(oth.hq), qInv(oth.qInv),
+                                      pk(oth.pk) { }
 
     bool operator==(const SecKeyImp &oth) {
-        return l == oth.l && pk == oth.pk;
+        return p == oth.p && q == oth.q && pk == oth.pk;
     }
 
     void Encrypt(Ctxt &ctxt, const NTL::ZZ &plain) const {
@@ -364,12 +439,18 @@ public:
     }
 
 
+    /// m = L(c^lambda mod n^2) / L(g^lambda mod n^2) mod n, computed
+    /// mod p^2 and q^2 with the half-length exponents p - 1 and q - 1.
     void Decrypt(NTL::ZZ &plain, const Ctxt &ctxt) const {
         assert(pk == ctxt.GetPk());
-        NTL::PowerMod(plain, ctxt.GetValue(), l, pk.GetN2());
-        plain -= 1;
-        plain /= pk.GetN();
-        NTL::MulMod(plain, plain, il, pk.GetN());
+        NTL::ZZ mp, mq;
+        DecryptHalf(mp, ctxt.GetValue(), p, p2, hp);
+        DecryptHalf(mq, ctxt.GetValue(), q, q2, hq);
+        // m = mq + q * ((mp - mq) * q^-1 mod p)
+        NTL::SubMod(plain, mp, mq % p, p);
+        NTL::MulMod(plain, plain, qInv, p);
+        plain *= q;
+        plain += mq;
     }
 
     void Decrypt(long &plain, const Ctxt &ctxt) const {
@@ -379,24 +460,47 @@ public:
     }
 
     void Unpack(std::vector<NTL::ZZ> &slots, const Ctxt &ctxt, int bits) const {
-        auto tmp_primes = pk.GetPrimes(bits);
+        const auto &basis = pk.GetBasis(bits);
 
         NTL::ZZ plain;
         Decrypt(plain, ctxt);
         if ((plain << 1) >= pk.GetN())
             plain -= pk.GetN();
-        slots.resize(tmp_primes.size());
-        for (size_t i = 0; i < tmp_primes.size(); i++) {
-            auto residue = plain % tmp_primes[i];
-            if ((residue << 1) >= tmp_primes[i])
-                residue -= tmp_primes[i];
-            slots[i] = residue;
+        basis.reduce(slots, plain);
+        for (size_t i = 0; i < slots.size(); i++) {
+            const auto &prime = basis.moduli()[i];
+            if ((slots[i] << 1) >= prime)
+                slots[i] -= prime;
         }
     }
 
     const PubKey &GetPk() const { return pk; }
 private:
-    NTL::ZZ l, il;
+    /// L_p(x) = (x - 1) / p
+    static void L(NTL::ZZ &res, const NTL::ZZ &x, const NTL::ZZ &prime) {
+        res = x - 1;
+        res /= prime;
+    }
+
+    /// L_p(g^(p-1) mod p^2)^-1 mod p
+    NTL::ZZ H(const NTL::ZZ &prime, const NTL::ZZ &prime2) const {
+        NTL::ZZ h;
+        NTL::PowerMod(h, pk.GetG() % prime2, prime - 1, prime2);
+        L(h, h, prime);
+        NTL::InvMod(h, h % prime, prime);
+        return h;
+    }
+
+    /// m mod p = L_p(c^(p-1) mod p^2) * hp mod p
+    static void DecryptHalf(NTL::ZZ &res, const NTL::ZZ &c, const NTL::ZZ &prime,
+                            const NTL::ZZ &prime2, const NTL::ZZ &h) {
+        NTL::rem(res, c, prime2);
+        NTL::PowerMod(res, res, prime - 1, prime2);
+        L(res, res, prime);
+        NTL::MulMod(res, res % prime, h, prime);
+    }
+
+    NTL::ZZ p, q, p2, q2, hp, hq, qInv;
     const PubKey pk;
 };
 
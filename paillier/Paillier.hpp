@@ -4,10 +4,12 @@
 #include <memory>
 #include <vector>
 namespace MDL {
+class CRTBasis;
 namespace Paillier {
 struct Encryption {};
 //forward declaration
 class Ctxt;
+class RandomnessPool;
 typedef std::vector<NTL::ZZ> PrimeSet;
 
 class PubKey {
@@ -15,6 +17,8 @@ public:
     explicit PubKey(const NTL::ZZ &n);
     PubKey(const PubKey &oth);
     PubKey& operator=(const PubKey &oth) = delete;
+    /// Copies of a key compare equal by their ID, other keys by n and the
+    /// primes.
     bool operator==(const PubKey &oth) const;
     ~PubKey() {}
     void Encrypt(Ctxt &ctxt, const NTL::ZZ &plain) const;
@@ -26,8 +30,23 @@ public:
     const NTL::ZZ& GetN2() const;
     const PrimeSet& GetPrimes() const;
     PrimeSet GetPrimes(long bits) const;
+    /// The CRT basis of GetPrimes(bits), built once per bits and used by
+    /// Pack and SecKey::Unpack.
+    const CRTBasis& GetBasis(long bits) const;
     long bits_per_prime() const;
     long bits_all_prime() const;
+    /// Fast randomness for Encrypt: r^n becomes h^a mod n^2 for a fixed
+    /// random n-th residue h and a random a of exponentBits bits (0 for
+    /// half of |n|). h^a comes from a comb table of h with window-bit
+    /// digits, i.e. about exponentBits / window multiplications.
+    void EnableFixedBase(long exponentBits = 0, long window = 6);
+    /// Keep capacity values of r^n mod n^2 ready, computed by background
+    /// workers. Encrypt and Ctxt::operator+=/-= take theirs from the pool.
+    /// Copies of the key made afterwards share the pool.
+    void EnableRandomnessPool(long capacity = 1024, long workers = 1);
+    void DisableRandomnessPool();
+    /// @return the pool, nullptr if it is not enabled.
+    std::shared_ptr<RandomnessPool> GetRandomnessPool() const;
 private:
     class PubKeyImp;
     std::shared_ptr<PubKeyImp> imp = nullptr;
@@ -51,11 +70,15 @@ private:
     std::shared_ptr<SecKeyImp> imp = nullptr;
 };
 
+/// A ciphertext is a value: it can be copied, moved and assigned, and
+/// refers to the key it was created with, which must outlive it.
 class Ctxt {
 public:
     explicit Ctxt(const PubKey &pk);
-    Ctxt(const Ctxt &oth);
-    Ctxt& operator=(const Ctxt &oth) = delete;
+    Ctxt(const Ctxt &oth) = default;
+    Ctxt(Ctxt &&oth) noexcept;
+    Ctxt& operator=(const Ctxt &oth) = default;
+    Ctxt& operator=(Ctxt &&oth) noexcept;
     Ctxt& operator+=(const Ctxt &oth);
     Ctxt& operator+=(long v);
     Ctxt& operator+=(const NTL::ZZ &v);
@@ -71,8 +94,8 @@ public:
     const PubKey& GetPk() const;
     const NTL::ZZ& GetValue() const;
 private:
-    class CtxtImp;
-    std::shared_ptr<CtxtImp> imp = nullptr;
+    NTL::ZZ value;
+    const PubKey *pk;
 };
 
 std::pair<SecKey, PubKey> GenKey(long bits);
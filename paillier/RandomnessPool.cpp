@@ -0,0 +1,84 @@
+#include "RandomnessPool.hpp"
+#include <algorithm>
+#include <cassert>
+namespace MDL {
+namespace Paillier {
+RandomnessPool::RandomnessPool(Generator generate, long capacity, long threads)
+    : generate(generate), capacity(std::max(1L, capacity))
+{
+    assert(this->generate);
+    threads = std::max(1L, threads);
+    for (long i = 0; i < threads; i++)
+        workers.push_back(std::thread([this]() { WorkerLoop(); }));
+}
+
+RandomnessPool::~RandomnessPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        stopping = true;
+    }
+    notFull.notify_all();
+    for (auto &w : workers) w.join();
+}
+
+void RandomnessPool::WorkerLoop()
+{
+    std::unique_lock<std::mutex> lock(mtx);
+    while (true) {
+        // values being computed count as taken, the pool never overfills.
+        notFull.wait(lock, [this]() {
+            return stopping || static_cast<long>(values.size()) + inflight < capacity;
+        });
+        if (stopping) return;
+
+        inflight += 1;
+        lock.unlock();
+        NTL::ZZ r;
+        generate(r);
+        lock.lock();
+        inflight -= 1;
+
+        values.emplace_back();
+        NTL::swap(values.back(), r);
+        if (static_cast<long>(values.size()) >= capacity)
+            full.notify_all();
+    }
+}
+
+void RandomnessPool::Take(NTL::ZZ &r)
+{
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (!values.empty()) {
+            NTL::swap(r, values.front());
+            values.pop_front();
+            notFull.notify_one();
+            return;
+        }
+        misses += 1;
+    }
+    generate(r);
+}
+
+void RandomnessPool::WaitFull()
+{
+    std::unique_lock<std::mutex> lock(mtx);
+    full.wait(lock, [this]() {
+        return static_cast<long>(values.size()) >= capacity;
+    });
+}
+
+long RandomnessPool::Size() const
+{
+    std::lock_guard<std::mutex> lock(mtx);
+    return static_cast<long>(values.size());
+}
+
+long RandomnessPool::Misses() const
+{
+    std::lock_guard<std::mutex> lock(mtx);
+    return misses;
+}
+} // namespace Paillier
+} // namespace MDL
@@ -0,0 +1,62 @@
+#ifndef PAILLIER_RANDOMNESSPOOL_HPP
+#define PAILLIER_RANDOMNESSPOOL_HPP
+#include <NTL/ZZ.h>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+namespace MDL {
+namespace Paillier {
+/// @brief Precomputed randomness r^n mod n^2 for encryption.
+/// Background threads keep up to capacity values ready, so an encryption
+/// only costs one modular multiplication while the pool is not empty.
+class RandomnessPool {
+public:
+    typedef std::function<void(NTL::ZZ &)> Generator;
+
+    /// @param generate. Computes one value, called from the workers.
+    /// @param capacity. The number of values kept ready.
+    /// @param workers. The number of background threads filling the pool.
+    RandomnessPool(Generator generate, long capacity, long workers);
+
+    /// Stops the workers after their current value.
+    ~RandomnessPool();
+
+    RandomnessPool(const RandomnessPool &oth) = delete;
+
+    RandomnessPool& operator=(const RandomnessPool &oth) = delete;
+
+    /// Take one value. When the pool is empty the value is computed in
+    /// the calling thread instead of waiting for the workers.
+    void Take(NTL::ZZ &r);
+
+    /// Return when the pool is full, e.g. before a latency-critical phase.
+    void WaitFull();
+
+    long Size() const;
+
+    long Capacity() const { return capacity; }
+
+    long Workers() const { return static_cast<long>(workers.size()); }
+
+    /// @return the number of values computed by Take() on an empty pool.
+    long Misses() const;
+private:
+    void WorkerLoop();
+
+    Generator generate;
+    const long capacity;
+    std::deque<NTL::ZZ> values;
+    long inflight = 0;
+    long misses = 0;
+    bool stopping = false;
+    mutable std::mutex mtx;
+    std::condition_variable notFull;
+    std::condition_variable full;
+    std::vector<std::thread> workers;
+};
+} // namespace Paillier
+} // namespace MDL
+#endif // paillier/RandomnessPool.hpp
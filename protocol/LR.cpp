@@ -6,8 +6,11 @@
 #include "algebra/NDSS.h"
 #include "utils/timer.hpp"
 #include "utils/FileUtils.hpp"
+#include "utils/Parallel.hpp"
+#include "utils/Levels.hpp"
+#include <algorithm>
 #include "multiprecision/Multiprecision.h"
-#include <thread>
+#include "algebra/MatrixProduct.hpp"
 namespace MDL
 {
 MPEncMatrix inverse(const MPEncMatrix &Q, const MPEncVector &mu,
@@ -15,27 +18,56 @@ MPEncMatrix inverse(const MPEncMatrix &Q, const MPEncVector &mu,
     auto M(Q), R(Q);
     auto MU(mu);
     auto I = MDL::eye(param.columnsToProcess); I *= 2;
+    // encode 2I once, every iteration only multiplies it by mu.
+    const bool flat = Q.getPacking() == MDL::FLAT_PACKING;
+    std::vector<MPEncodedVector> encodedI;
+    MPEncodedVector flatI;
+    if (flat) {
+        // mu is needed in every slot of the flat layout.
+        replicate(MU, param.ea, 0);
+        flatI.encode(MDL::flatten(I), param.ea);
+    } else {
+        encodedI = encodeRows(I, param.ea);
+    }
+
+    levels::Tracker tracker;
     for (int i = 0; i < MDL::LR::ITERATION; i++) {
+        long before = M.level();
         auto tmp(M);
         tmp.negate();
-        auto muI = mulMatrix(MU, I, param.ea);
-        tmp += muI; // tmp = 2 * mu * I - M
-        auto th1 = std::thread([&i, &R, &tmp, &param]() {
-                               if (i != 0) {
-                               R.dot(tmp, param.ea, param.pk,
-                                     param.columnsToProcess); // R = R(2 * mu * I - M)
-                               } else {
-                               R = tmp;
-                               }
-                               });
-        auto th2 = std::thread([&tmp, &M, &param]() {
-                               M.dot(tmp, param.ea, param.pk,
-                                     param.columnsToProcess); // M = M(2 * mu * I - M)
-                               });
-        th1.join();
-        th2.join();
+        if (flat) {
+            auto muI(MU);
+            muI.mulConstant(flatI);
+            tmp += MPEncMatrix(std::vector<MPEncVector>(1, muI));
+        } else {
+            tmp += mulMatrix(MU, encodedI);
+        } // tmp = 2 * mu * I - M
+        // R and M side by side, unless PROTOCOL runs serially.
+        parallel::parallel_for(parallel::PROTOCOL, 2,
+                               [&i, &R, &M, &tmp, &param](long which) {
+            if (which == 1) {
+                M.dot(tmp, param.ea, param.pk,
+                      param.columnsToProcess); // M = M(2 * mu * I - M)
+            } else if (i != 0) {
+                R.dot(tmp, param.ea, param.pk,
+                      param.columnsToProcess); // R = R(2 * mu * I - M)
+            } else {
+                R = tmp;
+            }
+        });
         MU.multiplyBy(MU);
+        tracker.step(before, M.level());
+
+        if (levels::isAuto()) {
+            // only keep the levels the remaining iterations need.
+            long stepsLeft = MDL::LR::ITERATION - 1 - i;
+            long needed = tracker.needed(stepsLeft + param.stepsAfter);
+            tracker.dropped(std::max({M.reserveLevels(needed),
+                                      R.reserveLevels(needed),
+                                      MU.reserveLevels(needed)}));
+        }
     }
+    tracker.report("inverse");
     return R;
 }
 
@@ -58,21 +90,17 @@ EncMatrix inverse(const EncMatrix &Q, long mu,
     for (int itr = 1; itr < LR::ITERATION; itr++) {
         auto tmpR(R), tmpM(M);
         MDL::Vector<long> mag(param.ea.size(), 2 * MU);
-        std::thread computeR([&tmpR, &param, &R, &M, &mag](){
-                             tmpR.dot(M, param.ea, param.columnsToProcess);
-                             R.multByConstant(mag.encode(param.ea));
-                             R -= tmpR;
-                             });
-#ifndef FHE_THREADS
-        computeR.join();
-#endif
-        std::thread computeM([&tmpM, &param, &M, &mag](){
-                             tmpM.dot(M, param.ea, param.columnsToProcess);
-                             });
-#ifdef FHE_THREADS
-        computeR.join();
-#endif
-        computeM.join();
+        parallel::parallel_for(parallel::PROTOCOL, 2,
+                               [&tmpR, &tmpM, &param, &R, &M,
+                                &mag](long which) {
+            if (which == 1) {
+                tmpM.dot(M, param.ea, param.columnsToProcess);
+                return;
+            }
+            tmpR.dot(M, param.ea, param.columnsToProcess);
+            R.multByConstant(mag.encode(param.ea));
+            R -= tmpR;
+        });
         M.multByConstant(mag.encode(param.ea));
         M -= tmpM;
         MU *= MU;
@@ -24,6 +24,9 @@ struct MPMatInverseParam {
     const MPPubKey &pk;
     const MPEncArray &ea;
     const long columnsToProcess;
+    /// matrix products the caller still runs on the inverse (e.g. 1 for
+    /// W = inv * XtY), the automatic modulus switching keeps room for them.
+    const long stepsAfter;
 };
 
 EncMatrix inverse(const EncMatrix &Q, long mu,
@@ -4,16 +4,9 @@
 #include "fhe/EncryptedArray.h"
 #include "fhe/replicate.h"
 #include "fhe/FHE.h"
+#include "utils/Parallel.hpp"
+#include "utils/FHEUtils.hpp"
 #include <vector>
-#include <thread>
-#include <atomic>
-#include <condition_variable>
-#include <chrono>
-#ifdef FHE_THREADS
-const long NRWORKER = 8;
-#else
-const long NRWORKER = 1;
-#endif
 namespace MDL {
 namespace Mode {
 class ConcreteResult : public Result {
@@ -54,38 +47,22 @@ Mode::Result::ptr computeMode(const Mode::Input &input,
 {
     auto results = std::make_shared<Mode::ConcreteResult>(input.slotToProcess);
     auto plainSpace = ea.getContext().alMod.getPPowR();
-    std::atomic<long> counter(0);
-    std::atomic<long> counter2(0);
-	std::atomic<bool> ok(false);
-	std::mutex cv_m;
-	std::condition_variable cv;
-    std::vector<std::thread> workers;
 	std::vector<MDL::EncVector> replicated(input.slotToProcess, input.slots);
 
-    for (long wr = 0; wr < NRWORKER; wr++) {
-        workers.push_back(std::thread([&](long id) {
-            long i;
-			while ((i = counter2.fetch_add(1)) < input.slotToProcess) {
-				replicate(ea, replicated[i], i);
-				if (i + 1 == input.slotToProcess) {
-					ok.store(true);
-					cv.notify_all();
-				}
-			}
-			{
-				std::unique_lock<std::mutex> lk(cv_m);
-				cv.wait(lk, [&]() { return ok.load(); });
-			}
-            while ((i = counter.fetch_add(1)) < input.slotToProcess) {
-                for (long j = i + 1; j < input.slotToProcess; j++) {
-                    GTInput<void> gt = {replicated[i], replicated[j],
-					input.valueDomain, plainSpace};
-                    results->put(GT(gt, ea), i, j);
-                }
-            } }, wr));
-    }
+    replicateAll(ea, input.slots, input.slotToProcess,
+                 [&replicated](long i, const Ctxt &replica) {
+        Ctxt &rep = replicated[i];
+        rep = replica;
+    });
 
-    for (auto &&wr : workers) wr.join();
+    parallel::parallel_for(parallel::PROTOCOL, input.slotToProcess,
+                           [&](long i) {
+        for (long j = i + 1; j < input.slotToProcess; j++) {
+            GTInput<void> gt = {replicated[i], replicated[j],
+                input.valueDomain, plainSpace};
+            results->put(GT(gt, ea), i, j);
+        }
+    });
 
     return results;
 }
@@ -96,24 +73,16 @@ long argMode(const Mode::Result::ptr results,
 {
     auto size = results->matrixSize();
     Matrix<long> booleanMatrix(size, size);
-    std::vector<std::thread> workers;
-    std::atomic<long> counter(0);
-
-    for (long wr = 0; wr < NRWORKER; wr++) {
-        workers.push_back(std::thread([&]() {
-        long i;
-        while ((i = counter.fetch_add(1)) < size) {
-            for (long j = i + 1; j < size; j++) {
-                auto gt = results->get(i, j);
-                assert(gt.second == true);
-                bool isGt = decrypt_gt_result(gt.first, sk, ea);
-                booleanMatrix[i][j] = isGt;
-                booleanMatrix[j][i] = !isGt;
-            }
-        } }));
-    }
 
-    for (auto &&wr : workers) wr.join();
+    parallel::parallel_for(parallel::PROTOCOL, size, [&](long i) {
+        for (long j = i + 1; j < size; j++) {
+            auto gt = results->get(i, j);
+            assert(gt.second == true);
+            bool isGt = decrypt_gt_result(gt.first, sk, ea);
+            booleanMatrix[i][j] = isGt;
+            booleanMatrix[j][i] = !isGt;
+        }
+    });
 
     for (long i = 0; i < size; i++) {
         bool flag = true;
@@ -4,6 +4,8 @@
 #include "fhe/EncryptedArray.h"
 #include "fhe/NumbTh.h"
 #include "multiprecision/Multiprecision.h"
+#include "utils/Levels.hpp"
+#include <algorithm>
 namespace MDL {
 std::pair<EncVector, EncVector> runPCA(const EncMatrix &mat,
                                        const EncryptedArray &ea,
@@ -32,11 +34,27 @@ std::pair<MPEncVector, MPEncVector> runPCA(const MPEncMatrix &mat,
     // so u1 = M * u0 is no need to do mulplication.
     for (size_t r = 1; r < mat.rowsNum(); r++) u += mat.get(r);
 
+    levels::Tracker tracker;
     for (long it = 1; it < PCA::ITERATION; it++) {
         std::cout << "iteration " << it << std::endl;
         previousU = u;
+        long before = u.level();
         u = mat.sDot(u, pk, ea);
+        tracker.step(before, u.level());
+
+        // u only has to survive the remaining products, the matrix
+        // keeps its level.
+        if (levels::isAuto()) {
+            long stepsLeft = PCA::ITERATION - 1 - it;
+            tracker.dropped(u.reserveLevels(tracker.needed(stepsLeft)));
+        }
+    }
+    if (levels::isAuto()) {
+        // both are only decrypted from here.
+        u.reserveLevels(0);
+        previousU.reserveLevels(0);
     }
+    tracker.report("runPCA");
     return {u, previousU};
 }
 
@@ -4,13 +4,8 @@
 #include "utils/FileUtils.hpp"
 #include "protocol/LR.hpp"
 #include "protocol/PCA.hpp"
-#include <thread>
-#ifdef FHE_THREADS
-const long WORKER_NR = 8;
-#else
-const long WORKER_NR = 1;
-#endif
 std::string gfile;
+std::string gkeys;
 long gD;
 long gMU;
 #ifdef USE_EIGEN
@@ -39,7 +34,11 @@ void benchmarkLR(const MPContext &context,
 #ifdef USE_EIGEN
     std::cout << "trueW " << getTrueW(_XtX, _XtY) << std::endl;
 #endif
-    XtX.pack(_XtX, pk, ea);
+    // the whole matrix in one ciphertext when the slots allow it.
+    auto packing = MDL::ROW_PACKING;
+    if (_XtX.rows() == _XtX.cols() && _XtX.rows() * _XtX.rows() <= ea.slots())
+        packing = MDL::FLAT_PACKING;
+    XtX.pack(_XtX, pk, ea, packing);
     XtY.pack(_XtY, ea);
     evalTimer.start();
     /* auto pair = MDL::runPCA(XtX, ea, pk); */
@@ -56,7 +55,7 @@ void benchmarkLR(const MPContext &context,
 
 	MDL::Timer lrEvalTimer;
 	lrEvalTimer.start();
-    MDL::MPMatInverseParam param = {pk, ea, gD - 1};
+    MDL::MPMatInverseParam param = {pk, ea, gD - 1, 1};
     auto inv = MDL::inverse(XtX, MU, param);
 
     auto W = inv.sDot(XtY, pk, ea);
@@ -88,15 +87,25 @@ int main(int argc, char *argv[]) {
     argmap.arg("f", gfile, "file");
     argmap.arg("u", gMU, "mu");
 	argmap.arg("D", gD, "dimension");
+    argmap.arg("k", gkeys, "key bundle to load, or to save the generated keys to");
     argmap.parse(argc, argv);
 	printf("m = %ld p = %ld r = %ld P = %ld L = %ld file = %s D = %ld Mu = %ld\n",
 		   m, p, r, P, L, gfile.c_str(), gD, gMU);
     MDL::Timer keyTimer;
     keyTimer.start();
-    MPContext context(m, p, r, P);
-    context.buildModChain(L);
-    MPSecKey sk(context);
-    MPPubKey pk(sk);
+    std::shared_ptr<MPContext> contextPtr;
+    std::shared_ptr<MPPubKey> pkPtr;
+    std::shared_ptr<MPSecKey> skPtr;
+    if (gkeys.empty() || !loadKeys(gkeys, contextPtr, pkPtr, skPtr) || !skPtr) {
+        contextPtr = std::make_shared<MPContext>(m, p, r, P);
+        contextPtr->buildModChain(L);
+        skPtr = std::make_shared<MPSecKey>(*contextPtr);
+        pkPtr = std::make_shared<MPPubKey>(*skPtr);
+        if (!gkeys.empty()) saveKeys(gkeys, *contextPtr, *pkPtr, skPtr.get());
+    }
+    const MPContext &context = *contextPtr;
+    const MPSecKey &sk = *skPtr;
+    const MPPubKey &pk = *pkPtr;
     MPEncArray ea(context);
     keyTimer.end();
     std::cout << "slots " << ea.slots() << " plainText: " << context.precision() << std::endl;
@@ -3,12 +3,6 @@
 #include "algebra/NDSS.h"
 #include "utils/timer.hpp"
 #include "utils/FileUtils.hpp"
-#include <thread>
-#ifdef FHE_THREADS
-const long WORKER_NR = 8;
-#else
-const long WORKER_NR = 1;
-#endif
 
 int main(int argc, char *argv[]) {
     ArgMapping argMap;
@@ -20,6 +14,8 @@ int main(int argc, char *argv[]) {
     argMap.arg("N", N, "N: How many record to use");
     argMap.arg("P", P, "P: How many primes to use");
     argMap.arg("M", M, "M: Magnifier");
+    std::string keys;
+    argMap.arg("k", keys, "k: key bundle to load, or to save the generated keys to");
     argMap.parse(argc, argv);
     if (m == 0 || p == 0 || r == 0 || L == 0) {
         printf("parameter!\n");
@@ -31,13 +27,24 @@ int main(int argc, char *argv[]) {
     auto maxEigValue = X.maxEigenValue();
 #endif
     keyTimer.start();
-    MPContext context(m, p, r, P);
-    context.buildModChain(L);
-    std::cout << "context done" << std::endl;
-    MPSecKey sk(context);
-    std::cout << "sk done" << std::endl;
-    MPPubKey pk(sk);
-    std::cout << "pk done" << std::endl;
+    std::shared_ptr<MPContext> contextPtr;
+    std::shared_ptr<MPPubKey> pkPtr;
+    std::shared_ptr<MPSecKey> skPtr;
+    if (!keys.empty() && loadKeys(keys, contextPtr, pkPtr, skPtr) && skPtr) {
+        std::cout << "keys loaded" << std::endl;
+    } else {
+        contextPtr = std::make_shared<MPContext>(m, p, r, P);
+        contextPtr->buildModChain(L);
+        std::cout << "context done" << std::endl;
+        skPtr = std::make_shared<MPSecKey>(*contextPtr);
+        std::cout << "sk done" << std::endl;
+        pkPtr = std::make_shared<MPPubKey>(*skPtr);
+        std::cout << "pk done" << std::endl;
+        if (!keys.empty()) saveKeys(keys, *contextPtr, *pkPtr, skPtr.get());
+    }
+    const MPContext &context = *contextPtr;
+    const MPSecKey &sk = *skPtr;
+    const MPPubKey &pk = *pkPtr;
     MPEncArray ea(context);
     std::cout << "ea done" << std::endl;
     keyTimer.end();
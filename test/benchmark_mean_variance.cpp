@@ -4,16 +4,13 @@
 #include <fhe/EncryptedArray.h>
 #include <utils/FileUtils.hpp>
 #include <utils/timer.hpp>
+#include <utils/Parallel.hpp>
 #include <algebra/NDSS.h>
 #include <thread>
 #include <atomic>
 #include <vector>
 
-#ifdef FHE_THREADS
-long WORKER_NR = 8;
-#else // ifdef FHE_THREADS
-long WORKER_NR = 1;
-#endif // ifdef FHE_THREAD
+long WORKER_NR = MDL::parallel::threads();
 std::vector<MDL::EncVector>encrypt(const MDL::Matrix<long>& data,
                                    const FHEPubKey        & pk,
                                    const EncryptedArray   & ea,
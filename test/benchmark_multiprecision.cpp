@@ -0,0 +1,78 @@
+#include "multiprecision/Multiprecision.h"
+#include "algebra/Vector.hpp"
+#include "utils/Parallel.hpp"
+#include "utils/timer.hpp"
+#include <fhe/NumbTh.h>
+#include <functional>
+#include <vector>
+
+static const int ROUNDS = 10;
+
+static double timing(const std::function<void()> &op)
+{
+    MDL::Timer timer;
+    timer.start();
+    for (int i = 0; i < ROUNDS; i++) op();
+    timer.end();
+    return timer.second() / ROUNDS;
+}
+
+/// Time the per-prime operations of MPEncVector with the parallelism of
+/// the multiprecision subsystem set to 1, 2, 4, ... threads. With P primes
+/// the speedup should be close to min(threads, P). unpack also spreads the
+/// CRT of the slots over the threads.
+int main(int argc, char *argv[]) {
+    long m = 5227, p = 67499, r = 1, P = 4, L = 8;
+    ArgMapping argmap;
+    argmap.arg("m", m, "m");
+    argmap.arg("p", p, "p");
+    argmap.arg("r", r, "r");
+    argmap.arg("P", P, "number of primes");
+    argmap.arg("L", L, "L");
+    argmap.parse(argc, argv);
+
+    MPContext context(m, p, r, P);
+    context.buildModChain(L);
+    MPSecKey sk(context);
+    MPPubKey pk(sk);
+    MPEncArray ea(context);
+    printf("slots %ld, parts %ld\n", ea.slots(), ea.arrayNum());
+
+    MDL::Vector<long> vec(ea.slots(), 1);
+    MPEncVector a(pk), b(pk);
+    a.pack(vec, ea);
+    b.pack(vec, ea);
+
+    // the shared pool is sized by the first setting, use the largest first.
+    const long maxThreads = MDL::parallel::threads(MDL::parallel::MULTIPRECISION);
+    std::vector<long> settings;
+    for (long t = 1; t < maxThreads; t <<= 1) settings.push_back(t);
+    settings.push_back(maxThreads);
+
+    MPEncodedVector encoded(vec, ea);
+    const int OPS = 7;
+    const char *names[OPS] = {"+=", "addConstant", "mulConstant",
+                              "mulConstant(encoded)", "dot", "totalSums",
+                              "unpack"};
+    std::vector<std::vector<double>> used(settings.size(), std::vector<double>(OPS));
+    for (size_t k = settings.size(); k-- > 0; ) {
+        MDL::parallel::setThreads(MDL::parallel::MULTIPRECISION, settings[k]);
+        used[k][0] = timing([&]() { MPEncVector tmp(a); tmp += b; });
+        used[k][1] = timing([&]() { MPEncVector tmp(a); tmp.addConstant(vec, ea); });
+        used[k][2] = timing([&]() { MPEncVector tmp(a); tmp.mulConstant(vec, ea); });
+        used[k][3] = timing([&]() { MPEncVector tmp(a); tmp.mulConstant(encoded); });
+        used[k][4] = timing([&]() { MPEncVector tmp(a); tmp.dot(b, ea); });
+        used[k][5] = timing([&]() { MPEncVector tmp(a); totalSums(tmp, ea); });
+        // the CRT of the slots runs on the ALGEBRA threads.
+        MDL::parallel::setThreads(MDL::parallel::ALGEBRA, settings[k]);
+        used[k][6] = timing([&]() { MDL::Vector<NTL::ZZ> out; a.unpack(out, sk, ea); });
+    }
+
+    for (size_t k = 0; k < settings.size(); k++) {
+        printf("threads %ld:", settings[k]);
+        for (int j = 0; j < OPS; j++)
+            printf(" %s %fs (x%.2f)", names[j], used[k][j], used[0][j] / used[k][j]);
+        printf("\n");
+    }
+    return 0;
+}
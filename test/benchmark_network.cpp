@@ -1,11 +1,19 @@
 #ifdef USE_NETWORK
 #include <nanomsg/nn.h>
 #include <nanomsg/reqrep.h>
+#include <nanomsg/pair.h>
 #include <unistd.h>
 #include <string>
 #include <stdio.h>
 #include "utils/timer.hpp"
 #include "network/network.hpp"
+#include "network/async.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <future>
+#include "utils/Wire.hpp"
+#include "fhe/FHE.h"
 void make_package(size_t sze, std::vector<size_t> &lens) {
 	const size_t _1KB = 1024;
 	while (sze >= _1KB) {
@@ -24,8 +32,56 @@ size_t check(struct nn_msghdr *nn_hdr, size_t sze) {
 	return count;
 }
 
-void act_client(std::string &addr, size_t sze) {
-	int sock = nn_socket(AF_SP, NN_REQ);
+size_t gBatches = 0;
+
+// fill batch k + 1 (standing in for the serialization) while batch k is
+// in flight.
+static void send_batches(int sock, const std::vector<void *> &data,
+                         const std::vector<size_t> &lens, size_t window) {
+	MDL::net::AsyncChannel channel(sock, window);
+	std::vector<std::future<bool>> sent;
+	size_t per = (lens.size() + gBatches - 1) / gBatches;
+	for (size_t first = 0; first < lens.size(); first += per) {
+		size_t last = std::min(first + per, lens.size());
+		for (size_t i = first; i < last; i++)
+			std::memset(data[i], (int)i, lens[i]);
+		sent.push_back(channel.send(
+			std::vector<void *>(data.begin() + first, data.begin() + last),
+			std::vector<size_t>(lens.begin() + first, lens.begin() + last)));
+	}
+	for (auto &f : sent) {
+		if (!f.get()) printf("Warnning! a batch was not sent\n");
+	}
+}
+
+// sum the bytes of a batch (standing in for the homomorphic accumulation)
+// while the later batches arrive.
+static void receive_batches(int sock, const std::vector<size_t> &lens) {
+	MDL::net::AsyncChannel channel(sock);
+	std::vector<std::future<bool>> received;
+	std::atomic<unsigned long> sum(0);
+	size_t per = (lens.size() + gBatches - 1) / gBatches;
+	for (size_t first = 0; first < lens.size(); first += per) {
+		size_t last = std::min(first + per, lens.size());
+		received.push_back(channel.receive(
+			std::vector<size_t>(lens.begin() + first, lens.begin() + last),
+			[&sum](size_t, const void *data, size_t len) {
+			auto bytes = (const unsigned char *)data;
+			unsigned long s = 0;
+			for (size_t i = 0; i < len; i++) s += bytes[i];
+			sum += s;
+		}));
+	}
+	for (auto &f : received) {
+		if (!f.get()) printf("Warnning! a batch was not received\n");
+	}
+	printf("checksum %lu\n", sum.load());
+}
+
+// window 1 is the stop-and-wait transfer over REQ/REP, larger windows
+// pipeline the chunks over PAIR sockets.
+void act_client(std::string &addr, size_t sze, size_t window) {
+	int sock = nn_socket(AF_SP, window > 1 ? NN_PAIR : NN_REQ);
 	std::string host = "tcp://" + addr + ":12345";
 	printf("host: %s\n", host.c_str());
 	if (nn_connect(sock, host.c_str()) < 0) {
@@ -44,9 +100,14 @@ void act_client(std::string &addr, size_t sze) {
 	nn_recv(sock, NULL, 0, 0);
 
 	timer.start();
-	MDL::net::send_all(sock, data, lens);
+	if (gBatches > 0)
+		send_batches(sock, data, lens, window);
+	else if (!(window > 1 ? MDL::net::send_all(sock, data, lens, window)
+	                      : MDL::net::send_all(sock, data, lens)))
+		printf("Warnning! send failed\n");
 	timer.end();
-	printf("send %f\n", timer.second());
+	printf("send %f window %zd %f MB/s\n", timer.second(), window,
+	       sze / timer.second() / (1 << 20));
 	nn_close(sock);
 
 	for (auto p : data) {
@@ -55,8 +116,8 @@ void act_client(std::string &addr, size_t sze) {
 	}
 }
 
-void act_server(size_t sze) {
-	int sock = nn_socket(AF_SP, NN_REP);
+void act_server(size_t sze, size_t window) {
+	int sock = nn_socket(AF_SP, window > 1 ? NN_PAIR : NN_REP);
 	std::string host = "tcp://*:12345";
 	if (nn_bind(sock, host.c_str()) < 0) {
             printf("Error: %s\n", nn_strerror(errno));
@@ -71,12 +132,37 @@ void act_server(size_t sze) {
 
 	MDL::Timer timer;
 	timer.start();
-	MDL::net::receive_all(sock, lens);
+	if (gBatches > 0)
+		receive_batches(sock, lens);
+	else
+		MDL::net::receive_all(sock, lens);
 	timer.end();
 
 	printf("receive %f\n", timer.second());
 	nn_close(sock);
 }
+
+// the wire size of a fresh ciphertext at its level and mod-switched down
+// to the levels the receiver needs.
+void act_compress(long m, long p, long L, long needed) {
+	FHEcontext context(m, p, 1);
+	buildModChain(context, L);
+	FHESecKey sk(context);
+	sk.GenSecKey(64);
+	Ctxt ctxt(sk);
+	sk.Encrypt(ctxt, NTL::to_ZZX(1));
+
+	MDL::Timer fullTimer, compactTimer;
+	fullTimer.start();
+	auto full = MDL::wire::encode(ctxt);
+	fullTimer.end();
+	compactTimer.start();
+	auto compact = MDL::wire::encode(MDL::wire::compact(ctxt, needed));
+	compactTimer.end();
+	printf("full %zd bytes %f s, %ld levels %zd bytes %f s (x%.2f)\n",
+	       full.size(), fullTimer.second(), needed, compact.size(),
+	       compactTimer.second(), (double)full.size() / compact.size());
+}
 #endif
 
 int main(int argc, char *argv[]) {
@@ -84,7 +170,9 @@ int main(int argc, char *argv[]) {
 	int oc, role;
 	std::string addr;
 	size_t sze;
-	while((oc = getopt(argc, argv, "r:a:c:")) != -1) {
+	size_t window = 1;
+	long m = 5227, p = 67499, L = 8, needed = 1;
+	while((oc = getopt(argc, argv, "r:a:c:w:m:p:L:l:b:")) != -1) {
 			switch (oc) {
 			case 'a':
 			addr = std::string(optarg);
@@ -95,15 +183,36 @@ int main(int argc, char *argv[]) {
 			case 'r':
 			role = std::atoi(optarg);
 			break;
+			case 'w':
+			window = std::strtol(optarg, NULL, 10);
+			break;
+			case 'm':
+			m = std::strtol(optarg, NULL, 10);
+			break;
+			case 'p':
+			p = std::strtol(optarg, NULL, 10);
+			break;
+			case 'L':
+			L = std::strtol(optarg, NULL, 10);
+			break;
+			case 'l':
+			needed = std::strtol(optarg, NULL, 10);
+			break;
+			case 'b':
+			gBatches = std::strtol(optarg, NULL, 10);
+			break;
 			}
 	}
 
 	switch (role) {
 	case 0:
-	act_client(addr, sze);
+	act_client(addr, sze, window);
 	break;
 	case 1:
-	act_server(sze);
+	act_server(sze, window);
+	break;
+	case 2:
+	act_compress(m, p, L, needed);
 	break;
 	}
 #endif
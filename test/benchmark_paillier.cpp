@@ -1,65 +1,85 @@
 #include "paillier/Paillier.hpp"
+#include "paillier/RandomnessPool.hpp"
+#include "paillier/Batch.hpp"
+#include "paillier/Packing.hpp"
 #include "utils/FileUtils.hpp"
 #include "algebra/NDSS.h"
 #include "utils/timer.hpp"
 #include "utils/encoding.hpp"
+#include "utils/Parallel.hpp"
+#include <cstdlib>
 #include <vector>
-#include <thread>
-#ifdef FHE_THREADS
-const long work_nr = 8;
-#else
-const long work_nr = 1;
-#endif
 
 std::vector<MDL::Paillier::Ctxt> encrypt(const MDL::Matrix<long> &data,
                                          const MDL::Paillier::PubKey &pk) {
     MDL::Timer timer;
     timer.start();
-    MDL::Paillier::Ctxt c(pk);
-    std::vector<MDL::Paillier::Ctxt> ctxts(data.rows(), c);
-#ifdef OMP
-	omp_set_num_threads(sysconf( _SC_NPROCESSORS_ONLN ));
-#endif
-#pragma omp parallel for
-    for (long i = 0; i < data.rows(); i++) {
-        pk.Pack(ctxts[i], data[i], 64);
-    }
+    std::vector<MDL::Paillier::Ctxt> ctxts;
+    MDL::Paillier::PackBatch(ctxts, data, 64, pk);
     timer.end();
-    printf("Enc %zd records cost %f sec\n", data.rows(), timer.second());
+    printf("Enc %zd records cost %f sec, %f records/s\n", data.rows(),
+           timer.second(), data.rows() / timer.second());
     return ctxts;
 }
 
+void decrypt(const std::vector<MDL::Paillier::Ctxt> &ctxts,
+             const MDL::Paillier::SecKey &sk) {
+    MDL::Timer timer;
+    timer.start();
+    std::vector<NTL::ZZ> plains;
+    MDL::Paillier::DecryptBatch(plains, ctxts, sk);
+    timer.end();
+    printf("Dec %zd records cost %f sec, %f records/s\n", ctxts.size(),
+           timer.second(), ctxts.size() / timer.second());
+}
+
 MDL::Paillier::Ctxt mean(const std::vector<MDL::Paillier::Ctxt> &ctxts) {
-    using namespace MDL;
-    std::vector<Paillier::Ctxt> parts;
-	auto parts_nr = std::min<long>(ctxts.size(), work_nr);
-    for (long i = 0; i < parts_nr; i++)
-        parts.push_back(ctxts[i]);
+    MDL::Timer timer;
+    timer.start();
+    MDL::Paillier::Ctxt sum(ctxts.front().GetPk());
+    MDL::Paillier::Sum(sum, ctxts);
+    timer.end();
+
+    printf("Mean of %zd records cost %f sec\n",
+           ctxts.size(), timer.second());
+    return sum;
+}
 
-    std::atomic<size_t> counter(parts.size());
-    std::vector<std::thread> workers;
-    auto process = [&](long id) {
-        while (true) {
-            auto next = counter.fetch_add(1);
-            if (next >= ctxts.size()) break;
-            parts[id] += ctxts[next];
-        }
-    };
+/// The same mean with as many values per ciphertext as the number of
+/// records allows.
+void packedMean(const MDL::Matrix<long> &data,
+                const MDL::Paillier::PubKey &pk,
+                const MDL::Paillier::SecKey &sk) {
+    using namespace MDL::Paillier;
+    long maxAbs = 1;
+    for (auto &row : data)
+        for (long v : row) maxAbs = std::max(maxAbs, std::abs(v));
+    auto layout = PackingLayout::Best(pk, NTL::NumBits(maxAbs), data.rows());
+    printf("%s packing: %ld slots of %ld bits, %ld additions, %ld ctxts per record\n",
+           layout.Mode() == CRT_PACKING ? "CRT" : "shift", layout.Slots(),
+           layout.SlotBits(), layout.Capacity(), layout.CtxtsFor(data.cols()));
 
     MDL::Timer timer;
     timer.start();
-    for (long i = 0; i < parts_nr; i++)
-        workers.push_back(std::thread(process, i));
+    std::vector<std::vector<MDL::Paillier::Ctxt>> records(data.rows());
+    MDL::parallel::parallel_for(MDL::parallel::PAILLIER, data.rows(), [&](long i) {
+        layout.Pack(records[i], data[i]);
+    });
+    timer.end();
+    printf("Packed enc %zd records cost %f sec\n", data.rows(), timer.second());
 
-    for (auto &&w : workers) w.join();
-    for (long i = 1; i < parts_nr; i++)
-        parts[0] += parts[i];
+    timer.reset();
+    PackedSum sum(layout, data.cols());
+    sum.Add(records);
     timer.end();
+    printf("Packed mean of %zd records cost %f sec, %zd ctxts\n", data.rows(),
+           timer.second(), sum.Groups().size() * layout.CtxtsFor(data.cols()));
 
-	auto sze = ctxts.size();
-    printf("Mean of %zd records cost %f sec\n",
-		   sze, timer.second());
-	return parts[0];
+    std::vector<NTL::ZZ> sums;
+    sum.Decrypt(sums, sk);
+    for (auto &s : sums)
+        std::cout << s << " ";
+    std::cout << "\n";
 }
 
 //std::vector<MDL::Paillier::Ctxt> encrypt_for_percentile(const MDL::Matrix<long> &data,
@@ -94,8 +114,13 @@ int main(int argc, char *argv[]) {
     long key_len = 1024;
     ArgMapping argmap;
     argmap.arg("f", file, "file");
+    long threads = 0;
     argmap.arg("k", key_len, "key length");
+    argmap.arg("t", threads, "threads, 0 for all");
     argmap.parse(argc, argv);
+    MDL::parallel::setThreads(MDL::parallel::PAILLIER, threads);
+    const long work_nr = MDL::parallel::threads(MDL::parallel::PAILLIER);
+    printf("threads %ld\n", work_nr);
 
     auto data = load_csv(file);
 
@@ -104,6 +129,20 @@ int main(int argc, char *argv[]) {
     MDL::Paillier::PubKey pk(keys.second);
 
     auto ctxts = encrypt(data, pk);
+    // the same records with the randomness from the fixed-base table.
+    MDL::Timer tableTimer;
+    tableTimer.start();
+    pk.EnableFixedBase();
+    tableTimer.end();
+    printf("Fixed-base table cost %f sec\n", tableTimer.second());
+    ctxts = encrypt(data, pk);
+    // and with the randomness precomputed offline.
+    pk.EnableRandomnessPool(data.rows(), work_nr);
+    pk.GetRandomnessPool()->WaitFull();
+    ctxts = encrypt(data, pk);
+    printf("Randomness pool misses %ld\n", pk.GetRandomnessPool()->Misses());
+    pk.DisableRandomnessPool();
+    decrypt(ctxts, sk);
 	auto res = mean(ctxts);
 	std::vector<NTL::ZZ> slots;
 	sk.Unpack(slots, res, 64);
@@ -111,5 +150,6 @@ int main(int argc, char *argv[]) {
 		std::cout << s << " ";
 	}
 	std::cout << "\n";
+    packedMean(data, pk, sk);
     return 0;
 }
@@ -6,17 +6,14 @@
 
 #include <utils/FileUtils.hpp>
 #include <utils/timer.hpp>
+#include <utils/Parallel.hpp>
 #include <utils/encoding.hpp>
 
 #include <protocol/Gt.hpp>
 
 #include <thread>
 #include <atomic>
-#ifdef FHE_THREADS
-long WORKER_NR = 8;
-#else // ifdef FHE_THREADS
-long WORKER_NR = 1;
-#endif // ifdef FHE_THREADS
+long WORKER_NR = MDL::parallel::threads();
 
 MDL::EncVector sum_ctxts(const std::vector<MDL::EncVector>& ctxts)
 {
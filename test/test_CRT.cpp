@@ -27,10 +27,64 @@ FHE setFHE(long m, long p, long r, long L)
     return fhe;
 }
 
+// CRTBasis agrees with CRT, reduce() inverts reconstruct().
+void testBasis(const std::vector<long> &primes) {
+    MDL::CRTBasis basis(primes);
+    for (int t = 0; t < 16; t++) {
+        std::vector<long> a(primes.size());
+        for (size_t i = 0; i < a.size(); i++)
+            a[i] = NTL::RandomBnd(primes[i]);
+        NTL::ZZ x;
+        basis.reconstruct(x, a);
+        assert(x == (MDL::CRT<long, long>(a, primes)));
+
+        std::vector<NTL::ZZ> residues;
+        basis.reduce(residues, x);
+        for (size_t i = 0; i < a.size(); i++)
+            assert(residues[i] == a[i]);
+    }
+
+    // many values at once, with fewer remainders than moduli.
+    std::vector<long> r0 = {1, 2, 3}, r1 = {4, 5, 6};
+    std::vector<NTL::ZZ> xs;
+    basis.reconstruct(xs, {r0.data(), r1.data()}, 3);
+    for (long s = 0; s < 3; s++) {
+        assert(xs[s] % primes[0] == r0[s]);
+        assert(xs[s] % primes[1] == r1[s]);
+        for (size_t i = 2; i < primes.size(); i++)
+            assert(xs[s] % primes[i] == 0);
+    }
+}
+
+// moduli above the word size take the ZZ path.
+void testWideBasis() {
+    std::vector<NTL::ZZ> primes = {NTL::power(NTL::to_ZZ(2), 61) - 1,
+                                   NTL::power(NTL::to_ZZ(2), 89) - 1,
+                                   NTL::power(NTL::to_ZZ(2), 107) - 1};
+    MDL::CRTBasis basis(primes);
+    std::vector<long> r0 = {1, -2, 3}, r1 = {4, 5, -6}, r2 = {7, 8, 9};
+    std::vector<NTL::ZZ> xs;
+    basis.reconstruct(xs, {r0.data(), r1.data(), r2.data()}, 3);
+    for (long s = 0; s < 3; s++) {
+        NTL::ZZ x;
+        basis.reconstruct(x, std::vector<long>{r0[s], r1[s], r2[s]});
+        assert(xs[s] == x);
+        assert(x < basis.product());
+        std::vector<NTL::ZZ> residues;
+        basis.reduce(residues, x);
+        assert(residues[0] == (r0[s] + primes[0]) % primes[0]);
+        assert(residues[1] == (r1[s] + primes[1]) % primes[1]);
+        assert(residues[2] == r2[s]);
+    }
+}
+
 int main() {
     std::vector<long> a{2, 30};
     std::vector<long> primes = {286238516299,380837045087,451652397359,438352100089,521930767949,407568125513,249530955953,312860439569,324960812177,280910000593};
     std::cout << MDL::CRT<long, long>({5, 8}, primes) << std::endl;
+    testBasis(primes);
+    testBasis({3, 5, 7});
+    testWideBasis();
 
     // auto fhe1 = setFHE(1031, 2, 2, 3);
     // auto fhe2 = setFHE(1031, 5, 2, 3);
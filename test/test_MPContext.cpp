@@ -7,6 +7,37 @@
 #include <NTL/ZZ.h>
 #include <iostream>
 #include <map>
+#include <sstream>
+
+// keys and ciphertexts survive a write/read round trip.
+static void testStorage(const MPContext &context, const MPSecKey &sk,
+                        const MPPubKey &pk, const MPEncArray &ea)
+{
+    std::stringstream keys;
+    writeKeys(keys, context, pk, &sk);
+    std::shared_ptr<MPContext> loadedContext;
+    std::shared_ptr<MPPubKey> loadedPk;
+    std::shared_ptr<MPSecKey> loadedSk;
+    bool read = readKeys(keys, loadedContext, loadedPk, loadedSk);
+    assert(read && loadedSk && loadedContext->primes() == context.primes());
+
+    MDL::Vector<long> vec(ea.slots());
+    for (long i = 0; i < vec.dimension(); i++) vec[i] = i;
+    MPEncArray loadedEa(*loadedContext);
+    MPEncVector enc(*loadedPk);
+    enc.pack(vec, loadedEa);
+
+    std::stringstream ctxts;
+    writeVector(ctxts, enc);
+    MPEncVector dec(*loadedPk);
+    read = readVector(ctxts, dec);
+    assert(read);
+    MDL::Vector<NTL::ZZ> result;
+    dec.unpack(result, *loadedSk, loadedEa);
+    for (long i = 0; i < vec.dimension(); i++)
+        assert(result[i] == vec[i]);
+    printf("storage ok\n");
+}
 
 int main() {
     long m, p, r, P;
@@ -20,6 +51,7 @@ int main() {
     MPPubKey pk(sk);
     MPEncArray ea(context);
     printf("going to pack with %ld slots\n", ea.slots());
+    testStorage(context, sk, pk, ea);
     MDL::Vector<long> vec(13);
     MDL::Matrix<long> mat(3, 3);
     for (int i = 0; i < vec.dimension(); i++)
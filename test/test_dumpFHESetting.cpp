@@ -1,27 +1,29 @@
 #include "utils/FHEUtils.hpp"
+#include "utils/KeyStore.hpp"
 #include "utils/timer.hpp"
 #include "fhe/EncryptedArray.h"
+#include <cstring>
+#include <fstream>
+#include <sstream>
 #include <string>
 #include "algebra/NDSS.h"
-void test_load(long m, long p, long r, long L)
+void test_load(const std::string &path)
 {
     MDL::Timer  timer;
-    std::string path("fhe_setting");
 
     timer.start();
-    FHEcontext context(m, p, r);
+    MDL::KeyStore store(path);
+    auto context = store.loadContext();
+    assert(context);
     timer.end();
-    printf("Initial Context costed %f\n", timer.second());
+    printf("Load context costed %f\n", timer.second());
 
     timer.reset();
-    FHESecKey sk(context);
+    FHESecKey sk(*context);
+    bool loaded = store.loadSecretKey(sk);
+    assert(loaded);
     timer.end();
-    printf("Initial SK costed %f\n", timer.second());
-
-    timer.reset();
-    load_FHE_setting(path, context, sk);
-    timer.end();
-    printf("Load costed %f sec.\n", timer.second());
+    printf("Load SK costed %f sec.\n", timer.second());
     FHEPubKey pk = sk;
     NTL::ZZX  plain;
     Ctxt ctxt(pk);
@@ -31,17 +33,85 @@ void test_load(long m, long p, long r, long L)
     sk.Decrypt(plain, ctxt);
     assert(plain == 100);
 
-    auto G = context.alMod.getFactorsOverZZ()[0];
-    EncryptedArray ea(context, G);
-    assert(ea.size() == 4);
+    // the rotation matrices are only read here.
+    timer.reset();
+    loaded = store.loadKeySwitching(sk);
+    assert(loaded);
+    timer.end();
+    printf("Load key-switching costed %f sec.\n", timer.second());
+
+    auto G = context->alMod.getFactorsOverZZ()[0];
+    EncryptedArray ea(*context, G);
+    std::vector<long> slots(ea.size(), 0), result;
+    slots[0] = 1;
+    Ctxt rotated(sk);
+    ea.encrypt(rotated, sk, slots);
+    ea.rotate(rotated, 1);
+    ea.decrypt(rotated, sk, result);
+    assert(result[1] == 1);
+}
+
+// a flipped byte in the rotation matrices is caught by the checksum,
+// the other sections still load.
+void test_corrupted(const std::string &path)
+{
+    std::ifstream in(path, std::ios::binary);
+    std::stringstream bytes;
+    bytes << in.rdbuf();
+    std::string file = bytes.str();
+
+    MDL::KeyStore::Header header;
+    std::memcpy(&header, file.data(), sizeof(header));
+    for (uint64_t i = 0; i < header.sections; i++) {
+        MDL::KeyStore::Section section;
+        std::memcpy(&section, file.data() + sizeof(header) + i * sizeof(section),
+                    sizeof(section));
+        if (section.type == MDL::KeyStore::KEY_SWITCHING)
+            file[section.offset + section.size / 2] ^= 0x5a;
+    }
+    const std::string broken = path + "_broken";
+    std::ofstream(broken, std::ios::binary) << file;
+
+    MDL::KeyStore store(broken);
+    auto context = store.loadContext();
+    assert(context);
+    FHESecKey sk(*context);
+    bool loaded = store.loadSecretKey(sk);
+    bool rejected = !store.loadKeySwitching(sk);
+    assert(loaded && rejected);
+}
+
+// files written before the key store format are still loaded.
+void test_legacy(const std::string &path)
+{
+    MDL::KeyStore store(path);
+    auto context = store.loadContext();
+    assert(context);
+    FHESecKey sk(*context);
+    bool read = store.loadSecretKey(sk);
+    assert(read);
+
+    const std::string legacy = path + "_text";
+    {
+        std::ofstream out(legacy);
+        out << *context;
+        out << sk;
+    }
+    unsigned long m, p, r;
+    read = store.contextBase(m, p, r);
+    assert(read);
+    FHEcontext loaded(m, p, r);
+    FHESecKey loadedSk(loaded);
+    load_FHE_setting(legacy, loaded, loadedSk);
+    assert(loadedSk == sk);
 }
 
-void test_dump(long m, long p, long r, long L)
+void test_dump(const std::string &path, long m, long p, long r, long L)
 {
     MDL::Timer timer;
 
     timer.start();
-    dump_FHE_setting_to_file("fhe_setting_32", 80, m, p, r, L);
+    dump_FHE_setting_to_file(path, 80, m, p, r, L);
     timer.end();
     printf("Cost %f to dump m : %ld, p : %ld, r : %ld, L : %ld\n",
            timer.second(), m, p, r, L);
@@ -56,8 +126,11 @@ int main(int argc, char *argv[]) {
     arg.arg("r", r, "r");
     arg.arg("L", L, "L");
     arg.parse(argc, argv);
-    //test_load(m, p, r, L);
 
-    test_dump(m, p, r, L);
+    const std::string path("fhe_setting_32");
+    test_dump(path, m, p, r, L);
+    test_load(path);
+    test_corrupted(path);
+    test_legacy(path);
     return 0;
 }
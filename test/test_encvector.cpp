@@ -4,6 +4,7 @@
 #include "fhe/FHE.h"
 #include "utils/FHEUtils.hpp"
 #include "utils/timer.hpp"
+#include "utils/Wire.hpp"
 void testEncVector(FHEPubKey& pk, FHESecKey& sk,
                    EncryptedArray& ea)
 {
@@ -106,6 +107,98 @@ void testEncMatrix(FHEPubKey& pk, FHESecKey& sk,
     }
 }
 
+void testDiagonalPacking(const FHEPubKey &pk,
+                         const FHESecKey &sk,
+                         const EncryptedArray &ea)
+{
+    // [[1 2 0]     [3
+    //  [3 4 5]]  *  1
+    //               2]
+    MDL::Matrix<long> mat(2, 3);
+    MDL::Vector<long> vec(ea.size());
+    mat[0][0] = 1; mat[0][1] = 2;
+    mat[1][0] = 3; mat[1][1] = 4; mat[1][2] = 5;
+    vec[0] = 3; vec[1] = 1; vec[2] = 2;
+
+    MDL::EncMatrix encMat(pk);
+    encMat.pack(mat, ea, MDL::DIAGONAL_PACKING);
+    MDL::EncVector encVec(pk);
+    encVec.pack(vec, ea);
+    {
+        MDL::Matrix<long> result;
+        encMat.unpack(result, sk, ea);
+        assert(result.rows() == 2 && result.cols() == 3);
+        assert(result[0][1] == 2);
+        assert(result[1][2] == 5);
+    }
+    {
+        MDL::Timer timer;
+        timer.start();
+        auto prod = encMat.dot(encVec, ea);
+        timer.end();
+        std::cout << "Diagonal Mat Vec Dot: " << timer.second() << std::endl;
+        MDL::Vector<long> result;
+        prod.unpack(result, sk, ea);
+        assert(result[0] == 5);
+        assert(result[1] == 23);
+    }
+    {
+        MDL::EncVector prod(encVec);
+        MDL::linearTransform(prod, mat, ea, 2);
+        MDL::Vector<long> result;
+        prod.unpack(result, sk, ea);
+        assert(result[0] == 5);
+        assert(result[1] == 23);
+        assert(result[2] == 0);
+    }
+}
+
+void testFlatPacking(const FHEPubKey &pk,
+                     const FHESecKey &sk,
+                     const EncryptedArray &ea)
+{
+    const long dimension = 3;
+    if (dimension * dimension > ea.size()) return;
+    MDL::Matrix<long> m1(dimension, dimension);
+    MDL::Matrix<long> m2(dimension, dimension);
+    MDL::Vector<long> vec(dimension);
+    for (long i = 0; i < dimension; i++) {
+        vec[i] = i + 1;
+        for (long j = 0; j < dimension; j++) {
+            m1[i][j] = i + j;
+            m2[i][j] = i - j;
+        }
+    }
+
+    MDL::EncMatrix encM1(pk), encM2(pk);
+    encM1.pack(m1, ea, MDL::FLAT_PACKING);
+    encM2.pack(m2, ea, MDL::FLAT_PACKING);
+    MDL::EncVector encVec(pk);
+    encVec.pack(vec, ea);
+    {
+        auto prod = encM1.dot(encVec, ea);
+        MDL::Vector<long> result;
+        prod.unpack(result, sk, ea, true);
+        auto expect = m1.dot(vec);
+        for (long i = 0; i < dimension; i++)
+            assert(result[i] == expect[i]);
+    }
+    {
+        MDL::Timer timer;
+        timer.start();
+        encM1.dot(encM2, ea);
+        timer.end();
+        printf("Flat product of two %ld x %ld matrices costed %f sec.\n",
+               dimension, dimension, timer.second());
+        MDL::Matrix<long> result;
+        encM1.unpack(result, sk, ea, true);
+        auto expect = m1.dot(m2);
+        for (long i = 0; i < dimension; i++)
+            for (long j = 0; j < dimension; j++)
+                assert(result[i][j] == expect[i][j]);
+    }
+}
+
 void testMatrixDotMatrix(const FHEPubKey &pk,
                          const FHESecKey &sk,
                          const EncryptedArray &ea)
@@ -137,6 +230,30 @@ void testMatrixDotMatrix(const FHEPubKey &pk,
     assert(result[1][1] == 50);
 }
 
+void testWire(const FHEPubKey &pk,
+              const FHESecKey &sk,
+              const EncryptedArray &ea)
+{
+    MDL::Vector<long> vec(ea.size());
+    for (long i = 0; i < vec.dimension(); i++) vec[i] = i;
+    MDL::EncVector encVector(pk);
+    encVector.pack(vec, ea);
+
+    // a too small fixed buffer fails, a growing one fits.
+    std::vector<char> small(16);
+    char *buf = small.data();
+    assert(MDL::wire::encode(encVector, buf, small.size()) == 0);
+    auto bytes = MDL::wire::encode(encVector);
+    assert(bytes.size() > MDL::wire::HEADER);
+
+    MDL::EncVector decoded(pk);
+    assert(MDL::wire::decode(decoded, bytes.data(), bytes.size()) == bytes.size());
+    MDL::Vector<long> result;
+    decoded.unpack(result, sk, ea);
+    for (long i = 0; i < vec.dimension(); i++)
+        assert(result[i] == vec[i]);
+}
+
 int main() {
     FHEcontext context(4097, 283, 1);
 
@@ -151,7 +268,10 @@ int main() {
     testEncVector(pk, sk, ea);
     testEncMatrix(pk, sk, ea);
     testMatrixDotMatrix(pk, sk, ea);
+    testDiagonalPacking(pk, sk, ea);
+    testFlatPacking(pk, sk, ea);
     testNegateUnpack(pk, sk, ea);
+    testWire(pk, sk, ea);
     std::cout << "All Tests Passed" << std::endl;
     return 0;
 }
@@ -7,14 +7,11 @@
 #include "utils/FileUtils.hpp"
 #include "utils/encoding.hpp"
 #include "utils/timer.hpp"
+#include "utils/Parallel.hpp"
 
 #include <vector>
 #include <thread>
-#ifdef FHE_THREADS
-long NR_WORKERS = 8;
-#else
-long NR_WORKERS = 1;
-#endif
+long NR_WORKERS = MDL::parallel::threads();
 
 MDL::EncVector encrypt(const MDL::Matrix<long> &mat,
                        const FHEPubKey &pk,
@@ -1,12 +1,17 @@
 #ifdef USE_NETWORK
 #include <nanomsg/nn.h>
 #include <nanomsg/reqrep.h>
+#include <nanomsg/pair.h>
 #include <iostream>
 #include <strstream>
 #include <cstring>
+#include <cassert>
+#include <thread>
 #include "fhe/FHEContext.h"
 #include "fhe/FHE.h"
 #include "network/network.hpp"
+#include "network/async.hpp"
+#include "algebra/EncVector.hpp"
 #include "utils/timer.hpp"
 
 void receive_pk(int socket, FHEPubKey &pk) {
@@ -32,66 +37,143 @@ void send_pk(int socket, const FHEPubKey &pk) {
     }
 }
 
-void send_ctxts(int socket, const std::vector<Ctxt> &ctxts) {
-    std::vector<void *> data;
-    std::vector<size_t> lens;
-    std::stringstream sstream;
+void send_ctxts(int socket, const std::vector<MDL::EncVector> &ctxts) {
     MDL::Timer timer;
-
-    for (auto &ctxt : ctxts) {
-        sstream.str("");
-        sstream << ctxt;
-        auto str = sstream.str();
-        auto len = str.size();
-        auto tmp = nn_allocmsg(len, 0);
-        std::memcpy(tmp, str.c_str(), len);
-        data.push_back(tmp);
-        lens.push_back(len);
-    }
-
-    MDL::net::msg_header *hdr;
-    MDL::net::make_header(&hdr, lens);
-    nn_send(socket, hdr, MDL::net::header_size(hdr), 0); // send lens
-    nn_recv(socket, NULL, 0, 0); // recv ok
-
-    struct nn_msghdr nn_hdr;
-    MDL::net::make_nn_header(&nn_hdr, data, lens);
     timer.start();
-    nn_sendmsg(socket, &nn_hdr, 0); // send data
+    long bytes = MDL::net::send(ctxts, socket);
     timer.end();
-    printf("sent %zd ctxt %f s\n", ctxts.size(), timer.second());
-    nn_recv(socket, NULL, 0, 0);
-    MDL::net::free_header(&nn_hdr, true);
+    printf("sent %zd ctxt %ld bytes %f s\n", ctxts.size(), bytes, timer.second());
 }
 
 void receive_ctxt(int socket, const FHEPubKey &pk,
-                  std::vector<Ctxt> &ctxts) {
-    std::stringstream sstream;
+                  std::vector<MDL::EncVector> &ctxts) {
     MDL::Timer timer;
-    char *buf;
-    nn_recv(socket, &buf, NN_MSG, 0); // recv lens
-    nn_send(socket, NULL, 0, 0); // send ok
-    MDL::net::msg_header *hdr = (MDL::net::msg_header *)buf;
-
-    std::vector<size_t> lens(hdr->msg_ele_sze,
-                             hdr->msg_ele_sze + hdr->msg_ele_nr);
-    printf("vec size %zd\n", lens.size());
     timer.start();
-    struct nn_msghdr nn_hdr;
-    MDL::net::make_nn_header(&nn_hdr, lens);
-    printf("%zd\n", nn_hdr.msg_iovlen);
-    nn_recvmsg(socket, &nn_hdr, 0); // recv data
+    long bytes = MDL::net::receive(ctxts, pk, socket);
     timer.end();
+    printf("receive %zd ciphers %ld bytes %fs\n", ctxts.size(), bytes,
+           timer.second());
+}
+
+unsigned char pattern(size_t i, size_t k) {
+    return (unsigned char)((i * 31 + k) & 0xFF);
+}
 
-    Ctxt c(pk);
-    for (size_t i = 0; i < nn_hdr.msg_iovlen; i++) {
-        sstream.str((char *)nn_hdr.msg_iov[i].iov_base);
-        sstream >> c;
-        ctxts.push_back(c);
+void make_payload(size_t nr, std::vector<void *> &data,
+                  std::vector<size_t> &lens) {
+    lens.resize(nr);
+    data.resize(nr);
+    for (size_t i = 0; i < nr; i++) {
+        lens[i] = 1 + i % 61;
+        auto bytes = new unsigned char[lens[i]];
+        for (size_t k = 0; k < lens[i]; k++)
+            bytes[k] = pattern(i, k);
+        data[i] = bytes;
     }
-    nn_freemsg(buf);
-    nn_send(socket, NULL, 0, 0);
-    printf("receive %zd ciphers %fs\n", ctxts.size(), timer.second());
+}
+
+void free_payload(std::vector<void *> &data) {
+    for (auto p : data) delete [](unsigned char *)p;
+    data.clear();
+}
+
+// an in-process PAIR, the server end is returned in server.
+int loopback(const char *addr, int *server) {
+    *server = nn_socket(AF_SP, NN_PAIR);
+    int client = nn_socket(AF_SP, NN_PAIR);
+    int bound = nn_bind(*server, addr);
+    int connected = nn_connect(client, addr);
+    assert(bound >= 0 && connected >= 0);
+    return client;
+}
+
+// pipelines the chunks over an in-process PAIR and checks every byte on the
+// receiving side. More than window * MAX_ELEMENT_NR elements so the sender
+// waits for acks with chunks still in flight.
+void test_windowed(size_t window) {
+    int server;
+    int client = loopback("inproc://test_windowed", &server);
+
+    const size_t nr = MDL::net::MAX_ELEMENT_NR * (window + 1) + 17;
+    std::vector<size_t> lens;
+    std::vector<void *> data;
+    make_payload(nr, data, lens);
+
+    size_t consumed = 0;
+    bool intact = true;
+    bool received = false;
+    std::thread receiver([&]() {
+        received = MDL::net::receive_all(server, lens,
+                                         [&](size_t i, const void *buf,
+                                             size_t len) {
+            auto bytes = (const unsigned char *)buf;
+            if (i != consumed || len != lens[i]) intact = false;
+            for (size_t k = 0; k < len && intact; k++)
+                intact = bytes[k] == pattern(i, k);
+            consumed += 1;
+        });
+    });
+    bool sent = MDL::net::send_all(client, data, lens, window);
+    receiver.join();
+
+    assert(sent && received);
+    assert(intact && consumed == nr);
+    free_payload(data);
+    nn_close(client);
+    nn_close(server);
+    printf("windowed %zd round trip of %zd elements ok\n", window, nr);
+}
+
+// queues several batches on one channel, the batches are not multiples of
+// MAX_ELEMENT_NR so the window spans the batch boundaries.
+void test_async(size_t window) {
+    int server;
+    int client = loopback("inproc://test_async", &server);
+
+    const size_t batches = 4;
+    const size_t per = MDL::net::MAX_ELEMENT_NR + 123;
+    const size_t nr = batches * per;
+    std::vector<size_t> lens;
+    std::vector<void *> data;
+    make_payload(nr, data, lens);
+
+    size_t consumed = 0;
+    bool intact = true;
+    std::vector<std::future<bool>> sent, received;
+    {
+        MDL::net::AsyncChannel receiver(server);
+        MDL::net::AsyncChannel sender(client, window);
+        for (size_t b = 0; b < batches; b++) {
+            const size_t first = b * per;
+            received.push_back(receiver.receive(
+                std::vector<size_t>(lens.begin() + first,
+                                    lens.begin() + first + per),
+                [&, first](size_t i, const void *buf, size_t len) {
+                auto bytes = (const unsigned char *)buf;
+                if (first + i != consumed || len != lens[first + i])
+                    intact = false;
+                for (size_t k = 0; k < len && intact; k++)
+                    intact = bytes[k] == pattern(first + i, k);
+                consumed += 1;
+            }));
+            sent.push_back(sender.send(
+                std::vector<void *>(data.begin() + first,
+                                    data.begin() + first + per),
+                std::vector<size_t>(lens.begin() + first,
+                                    lens.begin() + first + per)));
+        }
+        bool ok = true;
+        for (auto &f : sent) ok = f.get() && ok;
+        for (auto &f : received) ok = f.get() && ok;
+        assert(ok);
+    }
+
+    assert(intact && consumed == nr);
+    free_payload(data);
+    nn_close(client);
+    nn_close(server);
+    printf("async window %zd %zd batches of %zd elements ok\n", window,
+           batches, per);
 }
 
 long gM, gP, gR, gL;
@@ -102,7 +184,7 @@ void act_server(int socket) {
     FHEPubKey pk(context);
     receive_pk(socket, pk);
 
-    std::vector<Ctxt> ctxts(gC, pk);
+    std::vector<MDL::EncVector> ctxts(gC, MDL::EncVector(pk));
     for (long i = 0; i < gC; i++)
         pk.Encrypt(ctxts[i], NTL::to_ZZX(i));
     send_ctxts(socket, ctxts);
@@ -117,7 +199,7 @@ void act_client(int socket) {
     FHEPubKey &pk = sk;
     send_pk(socket, pk);
 
-    std::vector<Ctxt> ctxts;
+    std::vector<MDL::EncVector> ctxts;
     receive_ctxt(socket, pk, ctxts);
     nn_close(socket);
 }
@@ -132,7 +214,7 @@ int main(int argc, char *argv[]) {
     mapping.arg("p", gP, "p");
     mapping.arg("r", gR, "r");
     mapping.arg("L", gL, "L");
-    mapping.arg("R", role, "role, 0:server, 1:client");
+    mapping.arg("R", role, "role, 0:server, 1:client, 2:loopback");
     mapping.arg("H", host, "host");
     mapping.arg("C", gC, "cipher to send");
     mapping.parse(argc, argv);
@@ -154,6 +236,10 @@ int main(int argc, char *argv[]) {
         }
         printf("SID %d\n", sock);
         act_client(sock);
+    } else if (role == 2) {
+        test_windowed(3);
+        test_async(1);
+        test_async(3);
     }
 #endif
     return 0;
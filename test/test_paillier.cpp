@@ -1,5 +1,10 @@
 #include "paillier/Paillier.hpp"
+#include "paillier/RandomnessPool.hpp"
+#include "paillier/Batch.hpp"
+#include "paillier/Packing.hpp"
 #include "algebra/CRT.hpp"
+#include <cassert>
+#include <climits>
 #include <iostream>
 #include <vector>
 class LCtxt {
@@ -61,6 +66,135 @@ NTL::ZZ Decrypt(LCtxt &c, MDL::Paillier::SecKey &sk) {
     return (pl + bb) % sk.GetPk().GetN();
 }
 
+// plain, fixed-base and pooled randomness decrypt the same, negative
+// values too.
+void testEncrypt(const MDL::Paillier::SecKey &sk, MDL::Paillier::PubKey &pk) {
+    for (int mode = 0; mode < 3; mode++) {
+        if (mode == 1) pk.EnableFixedBase();
+        if (mode == 2) pk.EnableRandomnessPool(2, 2);
+        for (long m : {0L, 1L, 12345L, -7L}) {
+            MDL::Paillier::Ctxt c(pk);
+            pk.Encrypt(c, m);
+            c += 3;
+            NTL::ZZ plain;
+            sk.Decrypt(plain, c);
+            assert(plain == NTL::to_ZZ(m + 3) % pk.GetN());
+        }
+    }
+    pk.GetRandomnessPool()->WaitFull();
+    assert(pk.GetRandomnessPool()->Size() == 2);
+    pk.DisableRandomnessPool();
+}
+
+// CRT decryption over the whole plaintext range and through additions.
+void testDecrypt(const MDL::Paillier::SecKey &sk, const MDL::Paillier::PubKey &pk) {
+    for (int i = 0; i < 16; i++) {
+        NTL::ZZ m1 = NTL::RandomBnd(pk.GetN());
+        NTL::ZZ m2 = NTL::RandomBnd(pk.GetN());
+        MDL::Paillier::Ctxt c1(pk), c2(pk);
+        pk.Encrypt(c1, m1);
+        pk.Encrypt(c2, m2);
+        NTL::ZZ plain;
+        sk.Decrypt(plain, c1);
+        assert(plain == m1);
+        c1 += c2;
+        sk.Decrypt(plain, c1);
+        assert(plain == (m1 + m2) % pk.GetN());
+    }
+}
+
+// the batch calls match the single ones, the tree sum the serial one.
+void testBatch(const MDL::Paillier::SecKey &sk, const MDL::Paillier::PubKey &pk) {
+    for (long n : {1L, 5L, 33L}) {
+        std::vector<NTL::ZZ> plains(n), decrypted;
+        NTL::ZZ expected(0);
+        for (long i = 0; i < n; i++) {
+            plains[i] = NTL::to_ZZ(i * 7 - 3);
+            expected += plains[i];
+        }
+        std::vector<MDL::Paillier::Ctxt> ctxts;
+        MDL::Paillier::EncryptBatch(ctxts, plains, pk);
+        MDL::Paillier::DecryptBatch(decrypted, ctxts, sk);
+        for (long i = 0; i < n; i++)
+            assert(decrypted[i] == plains[i] % pk.GetN());
+
+        MDL::Paillier::Ctxt sum(pk);
+        bool summed = MDL::Paillier::Sum(sum, ctxts);
+        assert(summed);
+        NTL::ZZ plain;
+        sk.Decrypt(plain, sum);
+        assert(plain == expected % pk.GetN());
+
+        std::vector<MDL::Vector<long>> rows(n, MDL::Vector<long>(3, n));
+        std::vector<std::vector<NTL::ZZ>> slots;
+        MDL::Paillier::PackBatch(ctxts, rows, 16, pk);
+        MDL::Paillier::UnpackBatch(slots, ctxts, 16, sk);
+        for (auto &row : slots)
+            assert(row.size() >= 3 && row[0] == n && row[2] == n);
+    }
+}
+
+// ciphertexts are values: they can be resized, assigned and moved.
+void testValue(const MDL::Paillier::SecKey &sk, const MDL::Paillier::PubKey &pk) {
+    MDL::Paillier::PubKey copy(pk);
+    assert(copy == pk);
+    MDL::Paillier::Ctxt one(pk), two(copy);
+    pk.Encrypt(one, 1);
+    copy.Encrypt(two, 2);
+    std::vector<MDL::Paillier::Ctxt> ctxts(4, one);
+    ctxts[1] = two;
+    ctxts.resize(8, two);
+    ctxts[2] = std::move(ctxts[7]);
+    ctxts.pop_back();
+    MDL::Paillier::Ctxt sum(ctxts[0]);
+    for (size_t i = 1; i < ctxts.size(); i++)
+        sum += ctxts[i];
+    long plain;
+    sk.Decrypt(plain, sum);
+    assert(plain == 1 + 2 + 2 + 1 + 2 + 2 + 2);
+}
+
+// both packings sum signed records exactly, past the capacity too.
+void testPacking(const MDL::Paillier::SecKey &sk, const MDL::Paillier::PubKey &pk) {
+    using MDL::Paillier::PackingLayout;
+    for (auto mode : {MDL::Paillier::CRT_PACKING, MDL::Paillier::SHIFT_PACKING}) {
+        PackingLayout layout(pk, 8, 3, mode);
+        assert(layout.Valid() && layout.Capacity() >= 3);
+        const long values = layout.Slots() + 2;
+        std::vector<long> record(values, 255);
+        record[1] = 256;
+        std::vector<MDL::Paillier::Ctxt> ctxts;
+        bool overflowed = !layout.Pack(ctxts, record);
+        record[1] = LONG_MIN;
+        overflowed = !layout.Pack(ctxts, record) && overflowed;
+        assert(overflowed);
+
+        const long records = 2 * layout.Capacity() + 1;
+        std::vector<std::vector<MDL::Paillier::Ctxt>> packed(records);
+        std::vector<NTL::ZZ> expected(values, NTL::to_ZZ(0));
+        for (long r = 0; r < records; r++) {
+            for (long i = 0; i < values; i++) {
+                record[i] = (i + r) % 2 ? -255 + r : 255 - i % 7;
+                expected[i] += record[i];
+            }
+            bool ok = layout.Pack(packed[r], record);
+            assert(ok && packed[r].size() == 2);
+        }
+
+        MDL::Paillier::PackedSum one(layout, values), all(layout, values);
+        bool added = true;
+        for (auto &p : packed) added = one.Add(p) && added;
+        added = all.Add(packed) && added;
+        assert(added);
+        assert(one.Groups().size() == 3 && all.Groups().size() == 3);
+        std::vector<NTL::ZZ> sums;
+        one.Decrypt(sums, sk);
+        assert(sums == expected);
+        all.Decrypt(sums, sk);
+        assert(sums == expected);
+    }
+}
+
 int main() {
     NTL::SetSeed(NTL::to_ZZ(1000));
     auto keys = MDL::Paillier::GenKey(1024);
@@ -73,6 +207,11 @@ int main() {
     sk.Unpack(plt, c, 16);
     for (auto &pp : plt)
         std::cout << pp << " ";
+    testEncrypt(sk, pk);
+    testDecrypt(sk, pk);
+    testBatch(sk, pk);
+    testValue(sk, pk);
+    testPacking(sk, pk);
 //    auto multed = packed * packed;
 //
 //    auto pp = packed * packed % pk.GetN();
@@ -0,0 +1,47 @@
+#include "utils/ThreadPool.hpp"
+#include "utils/timer.hpp"
+#include <atomic>
+#include <cassert>
+#include <cstdio>
+#include <vector>
+
+void test_parallel_for()
+{
+    auto &pool = MDL::ThreadPool::global();
+    std::vector<long> out(1000, 0);
+    pool.parallel_for(out.size(), [&out](long i) { out[i] = i * i; });
+    for (size_t i = 0; i < out.size(); i++) assert(out[i] == static_cast<long>(i * i));
+}
+
+void test_nested()
+{
+    auto &pool = MDL::ThreadPool::global();
+    const long rows = 16, parts = 8;
+    std::atomic<long> counter(0);
+    pool.parallel_for(rows, [&](long) {
+        pool.parallel_for(parts, [&](long) { counter.fetch_add(1); });
+    });
+    assert(counter.load() == rows * parts);
+}
+
+void test_group()
+{
+    MDL::TaskGroup group;
+    std::atomic<long> counter(0);
+    for (long i = 0; i < 100; i++)
+        group.run([&counter]() { counter.fetch_add(1); });
+    group.wait();
+    assert(counter.load() == 100);
+}
+
+int main() {
+    MDL::Timer timer;
+    timer.start();
+    test_parallel_for();
+    test_nested();
+    test_group();
+    timer.end();
+    printf("%ld threads, passed in %f sec\n",
+           MDL::ThreadPool::global().concurrency(), timer.second());
+    return 0;
+}
@@ -0,0 +1,115 @@
+#ifndef UTILS_BINARYIO_HPP
+#define UTILS_BINARYIO_HPP
+#include <NTL/ZZ.h>
+#include <cstdint>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+namespace MDL {
+namespace binary {
+/// Integers are written as 8 bytes little-endian, byte strings with their
+/// length in front.
+inline void writeLong(std::ostream &out, long value)
+{
+    unsigned char bytes[8];
+    uint64_t v = static_cast<uint64_t>(static_cast<int64_t>(value));
+    for (int i = 0; i < 8; i++) bytes[i] = static_cast<unsigned char>(v >> (8 * i));
+    out.write(reinterpret_cast<const char *>(bytes), 8);
+}
+
+inline bool readLong(std::istream &in, long &value)
+{
+    unsigned char bytes[8];
+    if (!in.read(reinterpret_cast<char *>(bytes), 8)) return false;
+    uint64_t v = 0;
+    for (int i = 0; i < 8; i++) v |= static_cast<uint64_t>(bytes[i]) << (8 * i);
+    value = static_cast<long>(static_cast<int64_t>(v));
+    return true;
+}
+
+inline void writeBytes(std::ostream &out, const std::string &bytes)
+{
+    writeLong(out, static_cast<long>(bytes.size()));
+    out.write(bytes.data(), bytes.size());
+}
+
+inline bool readBytes(std::istream &in, std::string &bytes)
+{
+    long size;
+    if (!readLong(in, size) || size < 0) return false;
+    bytes.resize(size);
+    return size == 0 || static_cast<bool>(in.read(&bytes[0], size));
+}
+
+inline void writeLongs(std::ostream &out, const std::vector<long> &values)
+{
+    writeLong(out, static_cast<long>(values.size()));
+    for (long v : values) writeLong(out, v);
+}
+
+inline bool readLongs(std::istream &in, std::vector<long> &values)
+{
+    long size;
+    if (!readLong(in, size) || size < 0) return false;
+    values.resize(size);
+    for (long &v : values)
+        if (!readLong(in, v)) return false;
+    return true;
+}
+
+/// Non-negative ZZ as its little-endian bytes.
+inline void writeZZ(std::ostream &out, const NTL::ZZ &value)
+{
+    std::string bytes(NTL::NumBytes(value), '\0');
+    if (!bytes.empty())
+        NTL::BytesFromZZ(reinterpret_cast<unsigned char *>(&bytes[0]),
+                         value, bytes.size());
+    writeBytes(out, bytes);
+}
+
+inline bool readZZ(std::istream &in, NTL::ZZ &value)
+{
+    std::string bytes;
+    if (!readBytes(in, bytes)) return false;
+    NTL::ZZFromBytes(value, reinterpret_cast<const unsigned char *>(bytes.data()),
+                     bytes.size());
+    return true;
+}
+
+/// Objects that only have stream operators (the HElib contexts, keys and
+/// ciphertexts) are stored as a byte string of their stream output.
+template<class T>
+void writeObject(std::ostream &out, const T &obj)
+{
+    std::ostringstream sstream;
+    sstream << obj;
+    writeBytes(out, sstream.str());
+}
+
+template<class T>
+bool readObject(const std::string &bytes, T &obj)
+{
+    std::istringstream sstream(bytes);
+    sstream >> obj;
+    return !sstream.fail();
+}
+
+/// Check and skip a 4-byte magic and the version that follows it.
+inline bool readHeader(std::istream &in, const char *magic, long version)
+{
+    char buf[4];
+    long v;
+    if (!in.read(buf, 4) || std::string(buf, 4) != std::string(magic, 4))
+        return false;
+    return readLong(in, v) && v == version;
+}
+
+inline void writeHeader(std::ostream &out, const char *magic, long version)
+{
+    out.write(magic, 4);
+    writeLong(out, version);
+}
+} // namespace binary
+} // namespace MDL
+#endif // utils/BinaryIO.hpp
@@ -2,7 +2,14 @@
 // Created by riku on 5/5/15.
 //
 #include "FHEUtils.hpp"
+#include "ThreadPool.hpp"
+#include "KeyStore.hpp"
+#include "fhe/replicate.h"
+#include <NTL/ZZ.h>
+#include <algorithm>
+#include <cmath>
 #include <fstream>
+#include <sstream>
 
 static void process_in_log(Ctxt& res, const std::vector<Ctxt>& input,
                            functor func) {
@@ -78,27 +85,12 @@ void dump_FHE_setting_to_file(const std::string& file, long k,
                               long m, long p,
                               long r, long L)
 {
-    FHEcontext context(m, p, r);
-
-    FindM(k, L, 2, p, 0, 1, m, true);
-    buildModChain(context, L);
-    FHESecKey sk(context);
-    sk.GenSecKey(64);
-    addSome1DMatrices(sk);
-    std::fstream out;
-    out.open(file, std::ios::out);
-
-    if (!out.is_open()) {
-        std::cerr << "Can not open file: " << file << std::endl;
-        return;
-    }
-    out << context;
-    out << sk;
-    out.close();
+    MDL::KeyStore::dump(file, k, m, p, r, L);
 }
 
-void load_FHE_setting(const std::string& file,
-                      FHEcontext& context, FHESecKey& sk)
+/// the text format written before MDL::KeyStore.
+static void load_FHE_setting_text(const std::string& file,
+                                  FHEcontext& context, FHESecKey& sk)
 {
     std::ifstream in;
     std::stringstream sstream;
@@ -112,7 +104,183 @@ void load_FHE_setting(const std::string& file,
     sstream << in.rdbuf();
     sstream >> context;
     sstream >> sk;
-
-    // std::cout << str << std::endl;
     in.close();
 }
+
+void load_FHE_setting(const std::string& file,
+                      FHEcontext& context, FHESecKey& sk)
+{
+    if (!MDL::KeyStore::isKeyFile(file)) {
+        load_FHE_setting_text(file, context, sk);
+        return;
+    }
+
+    MDL::KeyStore store(file);
+
+    if (!store.isOpen()) return;
+    // KEY_SWITCHING holds the whole key, SECRET_KEY is only for the
+    // callers that never rotate.
+    if (!store.readContext(context) || !store.loadKeySwitching(sk)) {
+        std::cerr << "Can not load file: " << file << std::endl;
+    }
+}
+
+void totalSums(const EncryptedArray &ea, const long r, Ctxt &ctxt)
+{
+    assert(r >= 1 && r <= ea.size());
+    rotateSums(ea, ctxt, r);
+}
+
+/// the number of dependent rotation rounds of each layout.
+static long doublingRounds(long count)
+{
+    long rounds = 0;
+    for (long i = NTL::NumBits(count) - 2; i >= 0; i--)
+        rounds += 1 + NTL::bit(count, i);
+    return rounds;
+}
+
+static void bsgsSplit(long count, long &baby, long &giant, long &rest)
+{
+    baby = static_cast<long>(std::ceil(std::sqrt(static_cast<double>(count))));
+    giant = count / baby;
+    rest = count - baby * giant;
+}
+
+static long bsgsRounds(long count, long parallelism)
+{
+    long baby, giant, rest;
+    bsgsSplit(count, baby, giant, rest);
+    auto batches = [parallelism](long n) {
+        return (n + parallelism - 1) / parallelism;
+    };
+    return batches(baby - 1 + rest) + batches(giant - 1);
+}
+
+static void doublingSums(const EncryptedArray &ea, Ctxt &ctxt,
+                         long count, long stride)
+{
+    Ctxt orig(ctxt), tmp(ctxt);
+    long e = 1;
+    for (long i = NTL::NumBits(count) - 2; i >= 0; i--) {
+        tmp = ctxt;
+        ea.rotate(tmp, -e * stride);
+        ctxt += tmp; // ctxt covers 2e terms
+        e <<= 1;
+
+        if (NTL::bit(count, i)) {
+            tmp = orig;
+            ea.rotate(tmp, -e * stride);
+            ctxt += tmp; // add the (e + 1)-th term
+            e += 1;
+        }
+    }
+}
+
+/// slot j: baby = sum_{i < b} ctxt[j + i * stride], then
+/// result = sum_{k < g} baby[j + k * b * stride] plus the remaining terms
+/// b * g .. count - 1 rotated directly from ctxt.
+static void bsgsSums(const EncryptedArray &ea, Ctxt &ctxt,
+                     long count, long stride, long parallelism)
+{
+    long baby, giant, rest;
+    bsgsSplit(count, baby, giant, rest);
+    auto &pool = MDL::ThreadPool::global();
+
+    std::vector<Ctxt> rotated(baby - 1 + rest, ctxt);
+    pool.parallel_for(rotated.size(), [&](long i) {
+        long step = i < baby - 1 ? i + 1 : baby * giant + (i - baby + 1);
+        ea.rotate(rotated[i], -step * stride);
+    }, parallelism);
+
+    for (long i = 0; i < baby - 1; i++)
+        ctxt += rotated[i];
+
+    std::vector<Ctxt> giants(giant - 1, ctxt);
+    pool.parallel_for(giants.size(), [&](long k) {
+        ea.rotate(giants[k], -(k + 1) * baby * stride);
+    }, parallelism);
+
+    for (auto &g : giants)
+        ctxt += g;
+    for (long i = baby - 1; i < static_cast<long>(rotated.size()); i++)
+        ctxt += rotated[i];
+}
+
+void rotateSums(const EncryptedArray &ea, Ctxt &ctxt,
+                long count, long stride, long parallelism)
+{
+    if (count <= 1) return;
+    if (parallelism > 1 && bsgsRounds(count, parallelism) < doublingRounds(count))
+        bsgsSums(ea, ctxt, count, stride, parallelism);
+    else
+        doublingSums(ea, ctxt, count, stride);
+}
+
+namespace {
+/// forwards the first count replicas, the later ones are dropped.
+class CountingHandler : public ReplicateHandler {
+public:
+    CountingHandler(long count, const ReplicaHandler &handler)
+        : count(count), handler(handler) {}
+
+    void handle(const Ctxt &ctxt) override {
+        if (next < count) handler(next, ctxt);
+        next += 1;
+    }
+private:
+    long next = 0;
+    const long count;
+    const ReplicaHandler &handler;
+};
+
+/// the rotations of one replicate() call.
+long replicateCost(long slots)
+{
+    long cost = 1;
+    while ((1L << cost) < slots) cost += 1;
+    return cost;
+}
+} // namespace
+
+void replicateAll(const EncryptedArray &ea,
+                  const Ctxt &ctxt,
+                  long count,
+                  const ReplicaHandler &handler)
+{
+    if (count <= 0 || count > ea.size()) count = ea.size();
+    // a few replicas are cheaper one by one than a full pass over all the
+    // slots, which cannot be stopped early.
+    if (count * replicateCost(ea.size()) < ea.size()) {
+        Ctxt replica(ctxt.getPubKey());
+        for (long c = 0; c < count; c++) {
+            replica = ctxt;
+            replicate(ea, replica, c);
+            handler(c, replica);
+        }
+        return;
+    }
+    CountingHandler counting(count, handler);
+    replicateAll(ea, ctxt, &counting);
+}
+
+void replicateBlocks(const EncryptedArray &ea,
+                     const Ctxt &ctxt,
+                     long count,
+                     long block,
+                     const ReplicaBlockHandler &handler)
+{
+    block = std::max(1L, block);
+    std::vector<Ctxt> replicas;
+    long first = 0;
+    replicateAll(ea, ctxt, count,
+                 [&replicas, &first, block, &handler](long,
+                                                      const Ctxt &replica) {
+        replicas.push_back(replica);
+        if (static_cast<long>(replicas.size()) < block) return;
+        handler(first, replicas);
+        first += replicas.size();
+        replicas.clear();
+    });
+    if (!replicas.empty()) handler(first, replicas);
+}
@@ -8,7 +8,10 @@
 #include "fhe/Ctxt.h"
 #include "fhe/FHEContext.h"
 #include "fhe/FHE.h"
+#include "fhe/EncryptedArray.h"
+#include "MemoryStream.hpp"
 #include <cstring>
+#include <functional>
 #include <vector>
 #include <deque>
 #include <strstream>
@@ -40,28 +43,34 @@ void add_noise_to_coeff(Ctxt& res,
                         long  p,
                         long  except);
 
+/// Write v with its stream operator straight into the returned bytes.
+/// Use MDL::wire for ciphertexts on the wire.
 template<class T>
 std::vector<unsigned char>fhe_convert(const T& v)
 {
-    std::stringstream sstream;
-
-    sstream << v;
-    const auto& str = sstream.str();
-    const unsigned char *p = (const unsigned char *)str.c_str();
-    std::vector<unsigned char> cpy(str.size());
-    std::memcpy(cpy.data(), p, str.size());
-    return cpy;
+    std::vector<unsigned char> bytes(4096);
+    MDL::MemoryOutBuf buf(reinterpret_cast<char *>(bytes.data()), bytes.size(),
+                          [&bytes](char *, size_t size) {
+        bytes.resize(size);
+        return reinterpret_cast<char *>(bytes.data());
+    });
+    std::ostream out(&buf);
+    out << v;
+    bytes.resize(buf.size());
+    return bytes;
 }
 
+/// Parse v in place from the bytes.
 template<class T>
 void fhe_convert(T& v, const std::vector<unsigned char>& bytes)
 {
-    const char *p = (const char *)bytes.data();
-    std::string str(p, bytes.size());
-    std::stringstream sstream(str);
-    sstream >> v;
+    MDL::MemoryInBuf buf(bytes.data(), bytes.size());
+    std::istream in(&buf);
+    in >> v;
 }
 
+/// Write a context and a secret key in the binary key file format, see
+/// MDL::KeyStore.
 void dump_FHE_setting_to_file(const std::string& file,
                               long               k,
                               long               m,
@@ -69,6 +78,10 @@ void dump_FHE_setting_to_file(const std::string& file,
                               long               r,
                               long               L);
 
+/// Read a key file written by dump_FHE_setting_to_file() into a context
+/// built with the same (m, p, r). Text files written by older versions
+/// are still read. Use MDL::KeyStore directly to load the
+/// rotation matrices only when they are needed.
 void load_FHE_setting(const std::string& file,
                       FHEcontext       & context,
                       FHESecKey        & sk);
@@ -78,4 +91,45 @@ void load_FHE_setting(const std::string& file,
 /// @param r: the fitst r slots to Sum
 /// @param ctxt: ctxt that to be sum
 void totalSums(const EncryptedArray &ea, const long r, Ctxt &ctxt);
+
+/// Windowed sums of the slots:
+/// slot j becomes ctxt[j] + ctxt[j + stride] + ... + ctxt[j + (count - 1) * stride],
+/// indices taken cyclically. count = ceil(ea.size() / stride) sums all
+/// the slots in the same residue class of stride.
+/// Two layouts are available. Log-doubling does about 2 * log(count)
+/// dependent rotations. Baby-step/giant-step does about 2 * sqrt(count)
+/// rotations, but they form two batches of rotations of the same source
+/// that run concurrently. The one needing fewer rounds with the given
+/// parallelism is used, so parallelism = 1 keeps log-doubling.
+/// @param parallelism: the number of threads the rotations may use.
+void rotateSums(const EncryptedArray &ea,
+                Ctxt &ctxt,
+                long count,
+                long stride = 1,
+                long parallelism = 1);
+/// Called with the slot index c and the replica of the c-th slot.
+typedef std::function<void(long, const Ctxt &)> ReplicaHandler;
+
+/// Stream the replicas of the first count slots to handler, in the
+/// order of the slot index, from a single run of HElib's recursive
+/// replicateAll. Each replica then costs amortized O(1) operations
+/// instead of the O(log(slots)) of a separate replicate() call. The run
+/// covers all the slots, so when count * log(slots) is below the slot
+/// count the replicas are made one by one with replicate() instead.
+/// @param count: the number of replicas, 0 for ea.size().
+void replicateAll(const EncryptedArray &ea,
+                  const Ctxt &ctxt,
+                  long count,
+                  const ReplicaHandler &handler);
+
+/// Called with the slot index of the first replica of the block.
+typedef std::function<void(long, std::vector<Ctxt> &)> ReplicaBlockHandler;
+
+/// replicateAll() in blocks of at most block replicas, e.g. to work on a
+/// block in parallel. At most block replicas are held at a time.
+void replicateBlocks(const EncryptedArray &ea,
+                     const Ctxt &ctxt,
+                     long count,
+                     long block,
+                     const ReplicaBlockHandler &handler);
 #endif // CCS2015_FHEUTILS_HPP
@@ -0,0 +1,227 @@
+#include "KeyStore.hpp"
+#include "MemoryStream.hpp"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+namespace MDL {
+namespace {
+static const char MAGIC[4] = {'M', 'D', 'L', 'K'};
+
+uint64_t alignUp(uint64_t offset)
+{
+    return (offset + KeyStore::PAGE - 1) / KeyStore::PAGE * KeyStore::PAGE;
+}
+} // namespace
+
+uint64_t checksum(const char *bytes, size_t size)
+{
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= static_cast<unsigned char>(bytes[i]);
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+bool KeyStore::dump(const std::string &file,
+                    long k, long m, long p, long r, long L)
+{
+    m = FindM(k, L, 2, p, 0, 1, m, true);
+    FHEcontext context(m, p, r);
+    buildModChain(context, L);
+    FHESecKey sk(context);
+    sk.GenSecKey(64);
+
+    std::vector<std::pair<SectionType, std::string>> payloads;
+    {
+        std::ostringstream sstream;
+        writeContextBase(sstream, context);
+        sstream << context;
+        payloads.emplace_back(CONTEXT, sstream.str());
+    }
+    {
+        std::ostringstream sstream;
+        sstream << sk;
+        payloads.emplace_back(SECRET_KEY, sstream.str());
+    }
+    addSome1DMatrices(sk);
+    {
+        std::ostringstream sstream;
+        sstream << sk;
+        payloads.emplace_back(KEY_SWITCHING, sstream.str());
+    }
+
+    Header header;
+    std::memcpy(header.magic, MAGIC, 4);
+    header.version = VERSION;
+    header.sections = payloads.size();
+    std::vector<Section> sections;
+    uint64_t offset = alignUp(sizeof(Header) + payloads.size() * sizeof(Section));
+    for (auto &payload : payloads) {
+        Section s;
+        s.type = payload.first;
+        s.offset = offset;
+        s.size = payload.second.size();
+        s.checksum = checksum(payload.second.data(), payload.second.size());
+        sections.push_back(s);
+        offset = alignUp(offset + s.size);
+    }
+
+    std::ofstream out(file, std::ios::binary);
+    if (!out.is_open()) {
+        std::cerr << "Can not open file: " << file << std::endl;
+        return false;
+    }
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char *>(sections.data()),
+              sections.size() * sizeof(Section));
+    for (size_t i = 0; i < payloads.size(); i++) {
+        std::string padding(sections[i].offset - out.tellp(), '\0');
+        out.write(padding.data(), padding.size());
+        out.write(payloads[i].second.data(), payloads[i].second.size());
+    }
+    return static_cast<bool>(out);
+}
+
+bool KeyStore::isKeyFile(const std::string &file)
+{
+    std::ifstream in(file, std::ios::binary);
+    char magic[4];
+    if (!in.read(magic, 4)) return false;
+    return std::memcmp(magic, MAGIC, 4) == 0;
+}
+
+KeyStore::KeyStore(const std::string &file)
+{
+    int fd = open(file.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::cerr << "Can not open file: " << file << std::endl;
+        return;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(Header))) {
+        close(fd);
+        std::cerr << "Not a key file: " << file << std::endl;
+        return;
+    }
+    void *mapped = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED) {
+        std::cerr << "Can not map file: " << file << std::endl;
+        return;
+    }
+    data = static_cast<const char *>(mapped);
+    length = st.st_size;
+
+    Header header;
+    std::memcpy(&header, data, sizeof(header));
+    uint64_t tableEnd = sizeof(Header) + header.sections * sizeof(Section);
+    if (std::memcmp(header.magic, MAGIC, 4) != 0 || header.version != VERSION ||
+        header.sections > length / sizeof(Section) || tableEnd > length) {
+        std::cerr << "Not a key file: " << file << std::endl;
+        munmap(const_cast<char *>(data), length);
+        data = nullptr;
+        return;
+    }
+    table.resize(header.sections);
+    std::memcpy(table.data(), data + sizeof(Header),
+                header.sections * sizeof(Section));
+    verified.resize(table.size(), 0);
+}
+
+KeyStore::~KeyStore()
+{
+    if (data != nullptr)
+        munmap(const_cast<char *>(data), length);
+}
+
+const char *KeyStore::section(SectionType type, uint64_t &size) const
+{
+    std::lock_guard<std::mutex> lock(mtx);
+    for (size_t i = 0; i < table.size(); i++) {
+        const Section &s = table[i];
+        if (s.type != static_cast<uint64_t>(type)) continue;
+        if (s.offset > length || s.size > length - s.offset) return nullptr;
+        if (!verified[i]) {
+            if (checksum(data + s.offset, s.size) != s.checksum) {
+                fprintf(stderr, "Warnning! broken key file section %d\n", type);
+                return nullptr;
+            }
+            verified[i] = 1;
+        }
+        size = s.size;
+        return data + s.offset;
+    }
+    return nullptr;
+}
+
+bool KeyStore::contextBase(unsigned long &m, unsigned long &p,
+                           unsigned long &r) const
+{
+    uint64_t size;
+    const char *bytes = section(CONTEXT, size);
+    if (bytes == nullptr) return false;
+    MemoryInBuf buf(bytes, size);
+    std::istream in(&buf);
+    readContextBase(in, m, p, r);
+    return !in.fail();
+}
+
+std::shared_ptr<FHEcontext> KeyStore::loadContext() const
+{
+    unsigned long m, p, r;
+    if (!contextBase(m, p, r)) return nullptr;
+    auto context = std::make_shared<FHEcontext>(m, p, r);
+    if (!readContext(*context)) return nullptr;
+    return context;
+}
+
+bool KeyStore::readContext(FHEcontext &context) const
+{
+    uint64_t size;
+    const char *bytes = section(CONTEXT, size);
+    if (bytes == nullptr) return false;
+    MemoryInBuf buf(bytes, size);
+    std::istream in(&buf);
+    unsigned long m, p, r;
+    readContextBase(in, m, p, r);
+    in >> context;
+    return !in.fail();
+}
+
+bool KeyStore::loadSecretKey(FHESecKey &sk) const
+{
+    uint64_t size;
+    const char *bytes = section(SECRET_KEY, size);
+    if (bytes == nullptr) return false;
+    MemoryInBuf buf(bytes, size);
+    std::istream in(&buf);
+    in >> sk;
+    return !in.fail();
+}
+
+/// @return true if sk already holds the matrix of the first generator.
+static bool hasRotations(const FHESecKey &sk)
+{
+    const PAlgebra &zMStar = sk.getContext().zMStar;
+    return zMStar.numOfGens() > 0 &&
+           sk.haveKeySWmatrix(1, zMStar.ZmStarGen(0), 0, 0);
+}
+
+bool KeyStore::loadKeySwitching(FHESecKey &sk) const
+{
+    if (hasRotations(sk)) return true;
+    uint64_t size;
+    const char *bytes = section(KEY_SWITCHING, size);
+    if (bytes == nullptr) return false;
+    MemoryInBuf buf(bytes, size);
+    std::istream in(&buf);
+    in >> sk;
+    return !in.fail();
+}
+} // namespace MDL
@@ -0,0 +1,96 @@
+#ifndef UTILS_KEYSTORE_HPP
+#define UTILS_KEYSTORE_HPP
+#include "fhe/FHEContext.h"
+#include "fhe/FHE.h"
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+namespace MDL {
+/// @brief A binary key file that is memory-mapped when loading.
+/// Layout: a Header, a table of Section entries, then the payloads, each
+/// one aligned to PAGE bytes. The payloads are parsed directly from the
+/// mapped pages. A section's checksum is verified the first time it is
+/// used, so the pages of the sections that are never used are never read.
+///
+/// The secret key is stored twice. SECRET_KEY is the key right after
+/// GenSecKey(): it decrypts, encrypts and relinearizes. KEY_SWITCHING is
+/// the key with the rotation matrices added. loadKeySwitching() reads it
+/// into the key when rotations are needed.
+class KeyStore {
+public:
+    enum SectionType {
+        CONTEXT = 1,
+        SECRET_KEY = 2,
+        KEY_SWITCHING = 3
+    };
+
+    struct Header {
+        char magic[4];
+        uint32_t version;
+        uint64_t sections;
+    };
+
+    struct Section {
+        uint64_t type;
+        uint64_t offset;
+        uint64_t size;
+        uint64_t checksum;
+    };
+
+    static const uint32_t VERSION = 1;
+    static const uint64_t PAGE = 4096;
+
+    /// Generate a context and a secret key with the rotation matrices and
+    /// write them to the file.
+    static bool dump(const std::string &file,
+                     long k, long m, long p, long r, long L);
+
+    /// @return true if the file starts with the key file magic, false for
+    /// the text files written before this format.
+    static bool isKeyFile(const std::string &file);
+
+    /// Map the file. Check isOpen() for failures.
+    explicit KeyStore(const std::string &file);
+
+    ~KeyStore();
+
+    KeyStore(const KeyStore &oth) = delete;
+
+    KeyStore& operator=(const KeyStore &oth) = delete;
+
+    bool isOpen() const { return data != nullptr; }
+
+    /// @return the (m, p, r) of the stored context.
+    bool contextBase(unsigned long &m, unsigned long &p, unsigned long &r) const;
+
+    /// Build the stored context, nullptr on failure.
+    std::shared_ptr<FHEcontext> loadContext() const;
+
+    /// Read the stored context into one built with the same (m, p, r).
+    bool readContext(FHEcontext &context) const;
+
+    /// Read the secret key without the rotation matrices.
+    bool loadSecretKey(FHESecKey &sk) const;
+
+    /// Read the secret key with the rotation matrices into sk, nothing is
+    /// read if sk already has them. Call it before the first rotation, it
+    /// needs no loadSecretKey() before.
+    bool loadKeySwitching(FHESecKey &sk) const;
+private:
+    /// @return the payload of a verified section, nullptr if it is missing
+    /// or its checksum does not match.
+    const char *section(SectionType type, uint64_t &size) const;
+
+    const char *data = nullptr;
+    size_t length = 0;
+    std::vector<Section> table;
+    mutable std::vector<char> verified;
+    mutable std::mutex mtx;
+};
+
+/// FNV-1a of the bytes.
+uint64_t checksum(const char *bytes, size_t size);
+} // namespace MDL
+#endif // utils/KeyStore.hpp
@@ -0,0 +1,62 @@
+#include "Levels.hpp"
+#include "fhe/Ctxt.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+namespace MDL {
+namespace levels {
+static std::atomic<bool> autoSwitch(false);
+static std::once_flag envOnce;
+
+static void loadEnv()
+{
+    std::call_once(envOnce, []() {
+        const char *value = std::getenv("MDL_AUTO_MODSWITCH");
+        if (value != nullptr && std::strcmp(value, "0") != 0)
+            autoSwitch.store(true);
+    });
+}
+
+void setAuto(bool on)
+{
+    loadEnv();
+    autoSwitch.store(on);
+}
+
+bool isAuto()
+{
+    loadEnv();
+    return autoSwitch.load();
+}
+
+long level(const Ctxt &ctxt)
+{
+    return ctxt.findBaseLevel();
+}
+
+long reserve(Ctxt &ctxt, long needed)
+{
+    long current = level(ctxt);
+    long target = needed + MARGIN;
+    if (current <= target) return 0;
+    ctxt.modDownToLevel(target);
+    return current - level(ctxt);
+}
+
+void Tracker::step(long before, long after)
+{
+    consumedLevels += before - after;
+    maxStep = std::max(maxStep, before - after);
+}
+
+void Tracker::report(const char *name) const
+{
+    printf("%s: levels consumed %ld (at most %ld per step), dropped %ld\n",
+           name, consumedLevels, maxStep, droppedLevels);
+}
+
+} // namespace levels
+} // namespace MDL
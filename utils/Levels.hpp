@@ -0,0 +1,54 @@
+#ifndef UTILS_LEVELS_HPP
+#define UTILS_LEVELS_HPP
+class Ctxt;
+namespace MDL {
+namespace levels {
+/// Levels kept on top of what the remaining computation needs, so that
+/// the result still decrypts.
+const long MARGIN = 1;
+
+/// @brief Automatic modulus switching.
+/// When on, the iterative computations (LR inverse, PCA) drop their
+/// ciphertexts after each step to the lowest level that leaves room for
+/// the remaining steps. Later steps then run on smaller ciphertexts.
+/// Off by default, the environment variable MDL_AUTO_MODSWITCH=1 turns
+/// it on.
+void setAuto(bool on);
+
+bool isAuto();
+
+/// @return the level of the ciphertext, i.e. Ctxt::findBaseLevel().
+long level(const Ctxt &ctxt);
+
+/// Drop ctxt to needed + MARGIN levels, if it is above.
+/// @return the number of levels dropped.
+long reserve(Ctxt &ctxt, long needed);
+
+/// @brief Levels consumed by the steps of an iterative computation.
+class Tracker {
+public:
+    /// Record a step that took the ciphertexts from level before to after.
+    void step(long before, long after);
+
+    /// Record levels dropped by reserve().
+    void dropped(long levels) { droppedLevels += levels; }
+
+    /// @return the levels the steps consumed so far.
+    long consumed() const { return consumedLevels; }
+
+    /// @return the most levels a single step consumed.
+    long perStep() const { return maxStep; }
+
+    /// @return the levels the given number of further steps need.
+    long needed(long steps) const { return steps * maxStep; }
+
+    /// Print the levels consumed and dropped.
+    void report(const char *name) const;
+private:
+    long consumedLevels = 0;
+    long droppedLevels = 0;
+    long maxStep = 0;
+};
+} // namespace levels
+} // namespace MDL
+#endif // utils/Levels.hpp
@@ -0,0 +1,73 @@
+#ifndef UTILS_MEMORYSTREAM_HPP
+#define UTILS_MEMORYSTREAM_HPP
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <streambuf>
+namespace MDL {
+/// @brief An istream buffer over caller memory, nothing is copied.
+class MemoryInBuf : public std::streambuf {
+public:
+    MemoryInBuf(const void *bytes, size_t size)
+    {
+        char *p = static_cast<char *>(const_cast<void *>(bytes));
+        setg(p, p, p + size);
+    }
+
+    /// @return the bytes consumed so far.
+    size_t consumed() const { return gptr() - eback(); }
+};
+
+/// @brief An ostream buffer writing into caller memory.
+/// With grow set, the memory is reallocated by grow(old, newSize) when it
+/// is full (e.g. with nn_reallocmsg), otherwise the writing fails.
+class MemoryOutBuf : public std::streambuf {
+public:
+    typedef std::function<char *(char *, size_t)> Grow;
+
+    MemoryOutBuf(char *buf, size_t capacity, Grow grow = Grow())
+        : grow(grow)
+    {
+        setp(buf, buf + capacity);
+    }
+
+    char *data() const { return pbase(); }
+
+    size_t size() const { return pptr() - pbase(); }
+protected:
+    int_type overflow(int_type ch) override
+    {
+        if (traits_type::eq_int_type(ch, traits_type::eof()))
+            return traits_type::not_eof(ch);
+        if (!reserve(1)) return traits_type::eof();
+        *pptr() = traits_type::to_char_type(ch);
+        pbump(1);
+        return ch;
+    }
+
+    std::streamsize xsputn(const char *s, std::streamsize n) override
+    {
+        if (!reserve(n)) return 0;
+        std::memcpy(pptr(), s, n);
+        pbump(static_cast<int>(n));
+        return n;
+    }
+private:
+    bool reserve(size_t n)
+    {
+        if (static_cast<size_t>(epptr() - pptr()) >= n) return true;
+        if (!grow) return false;
+        size_t used = size();
+        size_t capacity = std::max(2 * static_cast<size_t>(epptr() - pbase()),
+                                   used + n);
+        char *buf = grow(pbase(), capacity);
+        if (buf == nullptr) return false;
+        setp(buf, buf + capacity);
+        pbump(static_cast<int>(used));
+        return true;
+    }
+
+    Grow grow;
+};
+} // namespace MDL
+#endif // utils/MemoryStream.hpp
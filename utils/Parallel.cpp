@@ -0,0 +1,78 @@
+#include "Parallel.hpp"
+#include "ThreadPool.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+namespace MDL {
+namespace parallel {
+static const char *ENV_NAMES[SUBSYSTEM_NR] = {
+    "MDL_THREADS",
+    "MDL_THREADS_ALGEBRA",
+    "MDL_THREADS_MULTIPRECISION",
+    "MDL_THREADS_PROTOCOL",
+    "MDL_THREADS_PAILLIER"
+};
+
+/// 0 means not set.
+static std::atomic<long> settings[SUBSYSTEM_NR];
+static std::once_flag envOnce;
+
+static long readEnv(const char *name)
+{
+    const char *value = std::getenv(name);
+    if (value == nullptr) return 0;
+    long threads = std::strtol(value, nullptr, 10);
+    return threads > 0 ? threads : 0;
+}
+
+static void loadEnv()
+{
+    std::call_once(envOnce, []() {
+        for (long sub = 0; sub < SUBSYSTEM_NR; sub++)
+            settings[sub].store(readEnv(ENV_NAMES[sub]));
+    });
+}
+
+static long hardwareThreads()
+{
+    long cores = static_cast<long>(std::thread::hardware_concurrency());
+    return cores > 0 ? cores : 1;
+}
+
+void setThreads(long threads)
+{
+    setThreads(DEFAULT, threads);
+}
+
+void setThreads(Subsystem sub, long threads)
+{
+    loadEnv();
+    settings[sub].store(threads > 0 ? threads : 0);
+}
+
+long threads(Subsystem sub)
+{
+    loadEnv();
+    long value = settings[sub].load();
+    if (value == 0 && sub != DEFAULT) value = settings[DEFAULT].load();
+    return value > 0 ? value : hardwareThreads();
+}
+
+long maxThreads()
+{
+    long most = threads(DEFAULT);
+    for (long sub = 1; sub < SUBSYSTEM_NR; sub++)
+        most = std::max(most, threads(static_cast<Subsystem>(sub)));
+    return most;
+}
+
+void parallel_for(Subsystem sub,
+                  long n,
+                  const std::function<void(long)> &body)
+{
+    ThreadPool::global().parallel_for(n, body, threads(sub));
+}
+} // namespace parallel
+} // namespace MDL
@@ -0,0 +1,42 @@
+#ifndef UTILS_PARALLEL_HPP
+#define UTILS_PARALLEL_HPP
+#include <functional>
+namespace MDL {
+namespace parallel {
+/// The parts of the library whose parallelism can be tuned separately.
+enum Subsystem {
+    DEFAULT = 0,
+    ALGEBRA,
+    MULTIPRECISION,
+    PROTOCOL,
+    PAILLIER,
+    SUBSYSTEM_NR
+};
+
+/// @brief The number of threads used by the whole library.
+/// The default is the hardware concurrency, or the value of the environment
+/// variable MDL_THREADS. Per-subsystem values come from MDL_THREADS_ALGEBRA,
+/// MDL_THREADS_MULTIPRECISION, MDL_THREADS_PROTOCOL and MDL_THREADS_PAILLIER.
+/// The shared ThreadPool is sized by the largest setting when it is first
+/// used; later settings can only lower the parallelism of a subsystem.
+/// @param threads. A value <= 0 restores the default.
+void setThreads(long threads);
+
+/// Override the number of threads of one subsystem.
+/// @param threads. A value <= 0 falls back to the DEFAULT setting.
+void setThreads(Subsystem sub, long threads);
+
+/// @return the number of threads the subsystem may use.
+long threads(Subsystem sub = DEFAULT);
+
+/// @return the largest setting among all subsystems.
+long maxThreads();
+
+/// Call body(i) for i in [0, n) on the shared ThreadPool with at most
+/// threads(sub) threads, the caller included.
+void parallel_for(Subsystem sub,
+                  long n,
+                  const std::function<void(long)> &body);
+} // namespace parallel
+} // namespace MDL
+#endif // utils/Parallel.hpp
@@ -0,0 +1,204 @@
+#include "ThreadPool.hpp"
+#include "Parallel.hpp"
+#include <chrono>
+namespace MDL {
+/// the pool and the queue index of the worker running in this thread.
+static thread_local ThreadPool *currentPool = nullptr;
+static thread_local long currentWorker = -1;
+
+/// the caller of parallel_for() is one of the threads.
+static long defaultWorkers()
+{
+    return parallel::maxThreads() - 1;
+}
+
+ThreadPool::ThreadPool(long workersNr)
+    : pending(0),
+      nextQueue(0)
+{
+    if (workersNr < 0) workersNr = 0;
+    for (long i = 0; i < workersNr; i++)
+        queues.push_back(std::unique_ptr<Queue>(new Queue()));
+
+    for (long i = 0; i < workersNr; i++)
+        workers.push_back(std::thread(&ThreadPool::workerLoop, this, i));
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lk(sleepMutex);
+        stopping = true;
+    }
+    wakeup.notify_all();
+    for (auto &&wr : workers) wr.join();
+}
+
+ThreadPool& ThreadPool::global()
+{
+    static ThreadPool pool(defaultWorkers());
+    return pool;
+}
+
+void ThreadPool::submit(Task task)
+{
+    if (workers.empty()) {
+        task();
+        return;
+    }
+
+    long target;
+    if (currentPool == this)
+        target = currentWorker;
+    else
+        target = static_cast<long>(nextQueue.fetch_add(1) % queues.size());
+
+    {
+        std::lock_guard<std::mutex> lk(queues[target]->mtx);
+        queues[target]->tasks.push_back(std::move(task));
+    }
+    pending.fetch_add(1);
+    {
+        // pairs with the predicate check in workerLoop so that
+        // the notification can not get lost.
+        std::lock_guard<std::mutex> lk(sleepMutex);
+    }
+    wakeup.notify_one();
+}
+
+bool ThreadPool::pop(Task &task, long self)
+{
+    const long num = static_cast<long>(queues.size());
+    if (self >= 0) {
+        std::lock_guard<std::mutex> lk(queues[self]->mtx);
+        if (!queues[self]->tasks.empty()) {
+            task = std::move(queues[self]->tasks.back());
+            queues[self]->tasks.pop_back();
+            pending.fetch_sub(1);
+            return true;
+        }
+    }
+
+    long start = self >= 0 ? self + 1 : static_cast<long>(nextQueue.load() % num);
+    for (long k = 0; k < num; k++) {
+        long victim = (start + k) % num;
+        if (victim == self) continue;
+        std::lock_guard<std::mutex> lk(queues[victim]->mtx);
+        if (!queues[victim]->tasks.empty()) {
+            task = std::move(queues[victim]->tasks.front());
+            queues[victim]->tasks.pop_front();
+            pending.fetch_sub(1);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ThreadPool::runPendingTask()
+{
+    if (queues.empty() || pending.load() == 0) return false;
+
+    Task task;
+    if (!pop(task, currentPool == this ? currentWorker : -1)) return false;
+    task();
+    return true;
+}
+
+void ThreadPool::workerLoop(long id)
+{
+    currentPool = this;
+    currentWorker = id;
+    Task task;
+    while (true) {
+        if (pop(task, id)) {
+            task();
+            task = nullptr;
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lk(sleepMutex);
+        wakeup.wait(lk, [this]() { return stopping || pending.load() > 0; });
+        if (stopping) return;
+    }
+}
+
+void ThreadPool::parallel_for(long n,
+                              const std::function<void(long)> &body,
+                              long parallelism)
+{
+    if (n <= 0) return;
+    long threads = concurrency();
+    if (parallelism > 0 && parallelism < threads) threads = parallelism;
+    if (threads > n) threads = n;
+
+    if (threads <= 1) {
+        for (long i = 0; i < n; i++) body(i);
+        return;
+    }
+
+    std::atomic<long> counter(0);
+    auto job = [&counter, &n, &body]() {
+        long i;
+        while ((i = counter.fetch_add(1)) < n) body(i);
+    };
+
+    TaskGroup group(*this);
+    for (long wr = 1; wr < threads; wr++) group.run(job);
+    job();
+    group.wait();
+}
+
+TaskGroup::TaskGroup(ThreadPool &pool)
+    : pool(pool),
+      state(std::make_shared<State>())
+{
+    state->unfinished.store(0);
+}
+
+TaskGroup::~TaskGroup()
+{
+    try {
+        wait();
+    } catch (...) {
+    }
+}
+
+void TaskGroup::run(ThreadPool::Task task)
+{
+    auto st = state;
+    st->unfinished.fetch_add(1);
+    pool.submit([st, task]() {
+        try {
+            task();
+        } catch (...) {
+            std::lock_guard<std::mutex> lk(st->mtx);
+            if (!st->error) st->error = std::current_exception();
+        }
+
+        if (st->unfinished.fetch_sub(1) == 1) {
+            std::lock_guard<std::mutex> lk(st->mtx);
+            st->done.notify_all();
+        }
+    });
+}
+
+void TaskGroup::wait()
+{
+    while (state->unfinished.load() > 0) {
+        if (pool.runPendingTask()) continue;
+        // the remaining tasks are running in other threads; sleep briefly
+        // so that tasks queued meanwhile (e.g. by nested loops) get helped.
+        std::unique_lock<std::mutex> lk(state->mtx);
+        state->done.wait_for(lk, std::chrono::microseconds(200), [this]() {
+            return state->unfinished.load() == 0;
+        });
+    }
+
+    std::exception_ptr error;
+    {
+        std::lock_guard<std::mutex> lk(state->mtx);
+        std::swap(error, state->error);
+    }
+    if (error) std::rethrow_exception(error);
+}
+} // namespace MDL
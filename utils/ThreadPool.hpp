@@ -0,0 +1,103 @@
+#ifndef UTILS_THREADPOOL_HPP
+#define UTILS_THREADPOOL_HPP
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+namespace MDL {
+/// @brief A work-stealing thread pool.
+/// Each worker owns a deque: it pops its own tasks from the back and steals
+/// from the front of the others' deques. A thread waiting on a TaskGroup
+/// keeps executing pending tasks instead of blocking, so nested parallel
+/// loops (e.g. rows x primes) share the same workers without spawning
+/// more threads than the pool has.
+class ThreadPool {
+public:
+    typedef std::function<void()> Task;
+
+    /// @param workers. Number of background threads. The thread calling
+    ///                 parallel_for() or TaskGroup::wait() also runs tasks.
+    explicit ThreadPool(long workers);
+
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &oth) = delete;
+
+    ThreadPool& operator=(const ThreadPool &oth) = delete;
+
+    /// @return the process-wide pool, sized by parallel::maxThreads()
+    ///         on first use.
+    static ThreadPool& global();
+
+    /// @return the number of threads that can run tasks, the caller included.
+    long concurrency() const { return static_cast<long>(workers.size()) + 1; }
+
+    /// Queue a task. Without background workers the task runs immediately.
+    void submit(Task task);
+
+    /// Run one pending task in the calling thread.
+    /// @return false if there was no task to run.
+    bool runPendingTask();
+
+    /// Call body(i) for every i in [0, n) and return when all are done.
+    /// @param parallelism. The maximum number of threads to use,
+    ///                     0 for concurrency().
+    void parallel_for(long n,
+                      const std::function<void(long)> &body,
+                      long parallelism = 0);
+private:
+    struct Queue {
+        std::mutex mtx;
+        std::deque<Task> tasks;
+    };
+
+    bool pop(Task &task, long self);
+
+    void workerLoop(long id);
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> workers;
+    std::mutex sleepMutex;
+    std::condition_variable wakeup;
+    std::atomic<long> pending;
+    std::atomic<unsigned long> nextQueue;
+    bool stopping = false;
+};
+
+/// @brief A set of tasks on a ThreadPool that can be waited for together.
+class TaskGroup {
+public:
+    explicit TaskGroup(ThreadPool &pool = ThreadPool::global());
+
+    /// Waits for the remaining tasks. Exceptions are dropped here;
+    /// call wait() to have them rethrown.
+    ~TaskGroup();
+
+    TaskGroup(const TaskGroup &oth) = delete;
+
+    TaskGroup& operator=(const TaskGroup &oth) = delete;
+
+    void run(ThreadPool::Task task);
+
+    /// Return when all the tasks are done. The calling thread executes
+    /// pending tasks of the pool meanwhile. The first exception thrown
+    /// by a task is rethrown here.
+    void wait();
+private:
+    struct State {
+        std::atomic<long> unfinished;
+        std::mutex mtx;
+        std::condition_variable done;
+        std::exception_ptr error;
+    };
+
+    ThreadPool &pool;
+    std::shared_ptr<State> state;
+};
+} // namespace MDL
+#endif // utils/ThreadPool.hpp
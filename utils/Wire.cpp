@@ -0,0 +1,79 @@
+#include "Wire.hpp"
+#include "Levels.hpp"
+#include "fhe/Ctxt.h"
+#include "fhe/FHEContext.h"
+#include <cstdint>
+#include <istream>
+#include <ostream>
+namespace MDL {
+namespace wire {
+static void putLength(char *buf, uint64_t length)
+{
+    for (size_t i = 0; i < HEADER; i++)
+        buf[i] = static_cast<char>(length >> (8 * i));
+}
+
+static uint64_t getLength(const unsigned char *buf)
+{
+    uint64_t length = 0;
+    for (size_t i = 0; i < HEADER; i++)
+        length |= static_cast<uint64_t>(buf[i]) << (8 * i);
+    return length;
+}
+
+size_t estimatedSize(const Ctxt &ctxt)
+{
+    // two parts of phi(m) residues per prime, at most 20 digits and a
+    // separator each.
+    const FHEcontext &context = ctxt.getContext();
+    size_t residues = context.zMStar.getPhiM() * card(ctxt.getPrimeSet());
+    return HEADER + 2 * residues * 21 + 256;
+}
+
+size_t encode(const Ctxt &ctxt, char *&buf, size_t capacity,
+              const MemoryOutBuf::Grow &grow)
+{
+    MemoryOutBuf out(buf, capacity, grow);
+    std::ostream stream(&out);
+    static const char header[HEADER] = {0};
+    stream.write(header, HEADER);
+    stream << ctxt;
+    buf = out.data();
+    if (stream.fail()) return 0;
+    putLength(buf, out.size() - HEADER);
+    return out.size();
+}
+
+std::vector<unsigned char> encode(const Ctxt &ctxt)
+{
+    std::vector<unsigned char> bytes(estimatedSize(ctxt));
+    char *buf = reinterpret_cast<char *>(bytes.data());
+    size_t used = encode(ctxt, buf, bytes.size(), [&bytes](char *, size_t size) {
+        bytes.resize(size);
+        return reinterpret_cast<char *>(bytes.data());
+    });
+    bytes.resize(used);
+    return bytes;
+}
+
+Ctxt compact(const Ctxt &ctxt, long needed)
+{
+    Ctxt copy(ctxt);
+    levels::reserve(copy, needed);
+    return copy;
+}
+
+size_t decode(Ctxt &ctxt, const void *buf, size_t size)
+{
+    if (size < HEADER) return 0;
+    auto bytes = static_cast<const unsigned char *>(buf);
+    uint64_t length = getLength(bytes);
+    if (length > size - HEADER) return 0;
+    MemoryInBuf in(bytes + HEADER, length);
+    std::istream stream(&in);
+    stream >> ctxt;
+    if (stream.fail()) return 0;
+    return HEADER + length;
+}
+} // namespace wire
+} // namespace MDL
@@ -0,0 +1,36 @@
+#ifndef UTILS_WIRE_HPP
+#define UTILS_WIRE_HPP
+#include "MemoryStream.hpp"
+#include "fhe/Ctxt.h"
+#include <cstddef>
+#include <vector>
+namespace MDL {
+namespace wire {
+/// A ciphertext on the wire: the 8-byte little-endian length of the body,
+/// then the body in the HElib stream form. EncVector is a Ctxt and uses
+/// the same encoding.
+const size_t HEADER = 8;
+
+/// @return a capacity that fits the encoding of ctxt in most cases.
+size_t estimatedSize(const Ctxt &ctxt);
+
+/// Encode ctxt into buf. With grow set, buf is reallocated when it is too
+/// small and updated to the new memory.
+/// @return the bytes written, 0 if they did not fit.
+size_t encode(const Ctxt &ctxt, char *&buf, size_t capacity,
+              const MemoryOutBuf::Grow &grow = MemoryOutBuf::Grow());
+
+std::vector<unsigned char> encode(const Ctxt &ctxt);
+
+/// @return ctxt mod-switched down to the levels the receiver's computation
+/// needs (plus MDL::levels::MARGIN), the smallest form it can still use.
+/// The size of a ciphertext is proportional to its level.
+Ctxt compact(const Ctxt &ctxt, long needed);
+
+/// Decode ctxt straight from buf, ctxt is built with the public key of
+/// the sender's ciphertext.
+/// @return the bytes consumed, 0 if buf does not hold a ciphertext.
+size_t decode(Ctxt &ctxt, const void *buf, size_t size);
+} // namespace wire
+} // namespace MDL
+#endif // utils/Wire.hpp